@@ -8,6 +8,16 @@
 #ifndef GETACTIVEDIMENSIONS
 #define GETACTIVEDIMENSIONS
 
-std::pair<int,int> getActiveAreaDimensionsForFilePath(const char * filePath);
+#include <stdint.h>
+#include <utility>
+#include <OpenImageIO/imageio.h>
+
+#include "activerows.h"
+
+//With sceneLinear the rows are compared as half floats, see scenelinear.h, so dark picture rows aren't taken for black
+std::pair<int,int> getActiveAreaDimensionsForFilePath(const char * filePath, bool sceneLinear = false);
+
+//Same as above on an image that is already open, which is left open for further reads
+std::pair<int,int> getActiveAreaDimensionsForImage(OIIO::ImageInput * in, bool sceneLinear = false);
 
 #endif
\ No newline at end of file
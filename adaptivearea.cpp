@@ -0,0 +1,62 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <stddef.h>
+
+#include "adaptivearea.h"
+#include "activerows.h"
+
+#define ADAPTIVE_AREA_CHANNELS 3
+
+HDRAdaptiveAreaReducer::HDRAdaptiveAreaReducer(const HDRLightLevelKernel & kernel, int width, HDRLightLevelAccumulator * accumulator) :
+    kernel(kernel), width(width), accumulator(accumulator), firstPictureRow(-1), lastPictureRow(-1) {
+}
+
+void HDRAdaptiveAreaReducer::reduceRow(const uint16_t * row, int y){
+    
+    if (rowIsFlat(row, width)) {
+        if (!flatRuns.empty() && flatRuns.back().code == row[0]) {
+            flatRuns.back().count++;
+        } else {
+            FlatRun run = {row[0], 1};
+            flatRuns.push_back(run);
+        }
+        return;
+    }
+    
+    if (firstPictureRow == -1) {
+        firstPictureRow = y;
+        flatRuns.clear();
+    } else {
+        reduceFlatRuns();
+    }
+    
+    kernel.reduceRow(row, width, kernel.lookupTable, accumulator);
+    lastPictureRow = y;
+}
+
+std::pair<int, int> HDRAdaptiveAreaReducer::finish(int height){
+    
+    if (firstPictureRow == -1) {
+        reduceFlatRuns();
+        return std::make_pair(0, height);
+    }
+    
+    flatRuns.clear();
+    return std::make_pair(firstPictureRow, lastPictureRow + 1 - firstPictureRow);
+}
+
+void HDRAdaptiveAreaReducer::reduceFlatRuns(){
+    
+    for (size_t i = 0; i < flatRuns.size(); i++) {
+        flatRow.assign((size_t)width * ADAPTIVE_AREA_CHANNELS, flatRuns[i].code);
+        for (int j = 0; j < flatRuns[i].count; j++) {
+            kernel.reduceRow(flatRow.data(), width, kernel.lookupTable, accumulator);
+        }
+    }
+    
+    flatRuns.clear();
+}
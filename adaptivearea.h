@@ -0,0 +1,54 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef ADAPTIVEAREA
+#define ADAPTIVEAREA
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "luminancekernel.h"
+
+/*
+ Finds the active rows of a frame while its rows stream through the light level kernel from top to
+ bottom, for reels whose aspect ratio changes from shot to shot.
+
+ Flat rows (see rowIsFlat) are not reduced as they arrive. Flat rows above the first picture row are
+ letterbox and are dropped. Flat rows after it are held back as runs of one code value and only
+ reduced, from a row filled with that code, once another picture row shows they are inside the
+ picture, so the bottom letterbox is dropped too. The accumulator ends up exactly as if the detected
+ rows had been reduced on their own. A frame with no picture rows at all is measured whole.
+ */
+
+class HDRAdaptiveAreaReducer {
+public:
+    HDRAdaptiveAreaReducer(const HDRLightLevelKernel & kernel, int width, HDRLightLevelAccumulator * accumulator);
+
+    //Rows must arrive in order, y counting from the top of the frame
+    void reduceRow(const uint16_t * row, int y);
+
+    //Call once after the last row. Returns the active rows as (y, height).
+    std::pair<int, int> finish(int height);
+
+private:
+    typedef struct {
+        uint16_t code;
+        int count;
+    } FlatRun;
+
+    void reduceFlatRuns();
+
+    HDRLightLevelKernel kernel;
+    int width;
+    HDRLightLevelAccumulator * accumulator;
+    int firstPictureRow;
+    int lastPictureRow;
+    std::vector<FlatRun> flatRuns;      //Flat rows since the last picture row
+    std::vector<uint16_t> flatRow;      //Only allocated when flat rows turn out to be inside the picture
+};
+
+#endif
@@ -0,0 +1,77 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <stdlib.h>
+#include <atomic>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "bufferarena.h"
+
+#define BUFFER_ARENA_ALIGNMENT 64
+#define BUFFER_ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static std::atomic<bool> arenaUsesHugePages(false);
+static std::atomic<long long> arenaAllocations(0);
+static std::atomic<long long> arenaBytes(0);
+
+HDRBufferArena::HDRBufferArena() : data(NULL), capacity(0) {
+}
+
+HDRBufferArena::~HDRBufferArena(){
+    free(data);
+}
+
+void * HDRBufferArena::reserve(size_t bytes){
+    
+    if (bytes <= capacity) {
+        return data;
+    }
+    
+    free(data);
+    data = NULL;
+    capacity = 0;
+    
+    size_t alignment = BUFFER_ARENA_ALIGNMENT;
+    
+    if (arenaUsesHugePages) {
+        alignment = BUFFER_ARENA_HUGE_PAGE_SIZE;
+        bytes = ((bytes + BUFFER_ARENA_HUGE_PAGE_SIZE - 1) / BUFFER_ARENA_HUGE_PAGE_SIZE) * BUFFER_ARENA_HUGE_PAGE_SIZE;
+    }
+    
+    if (posix_memalign(&data, alignment, bytes) != 0) {
+        data = NULL;
+        return NULL;
+    }
+    
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (arenaUsesHugePages) {
+        madvise(data, bytes, MADV_HUGEPAGE);
+    }
+#endif
+    
+    capacity = bytes;
+    arenaAllocations++;
+    arenaBytes += bytes;
+    
+    return data;
+}
+
+HDRBufferArena & threadBufferArena(){
+    static thread_local HDRBufferArena arena;
+    return arena;
+}
+
+void setBufferArenaUsesHugePages(bool useHugePages){
+    arenaUsesHugePages = useHugePages;
+}
+
+HDRBufferArenaCounters bufferArenaCounters(){
+    HDRBufferArenaCounters counters = {arenaAllocations, arenaBytes};
+    return counters;
+}
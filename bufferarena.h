@@ -0,0 +1,56 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef BUFFERARENA
+#define BUFFERARENA
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ Pixel memory that outlives a frame. An arena grows to the size of the first frame it is asked for
+ and then hands the same block back for every following frame of that size, uninitialized, so the
+ steady state costs neither allocations nor page faults. Each worker thread owns one arena, and each
+ frame of the pipelined pool owns its own.
+
+ With huge pages turned on, blocks are 2 MB aligned and advised as transparent huge pages (Linux only).
+ */
+
+typedef struct {
+    long long allocations;
+    long long bytes;
+} HDRBufferArenaCounters;
+
+class HDRBufferArena {
+public:
+    HDRBufferArena();
+    ~HDRBufferArena();
+
+    //At least bytes of storage, only allocating when the arena has never been this large. NULL if the allocation fails.
+    void * reserve(size_t bytes);
+
+    uint16_t * reservePixels(size_t elements){
+        return (uint16_t *)reserve(elements * sizeof(uint16_t));
+    }
+
+private:
+    HDRBufferArena(const HDRBufferArena &);
+    HDRBufferArena & operator=(const HDRBufferArena &);
+
+    void * data;
+    size_t capacity;
+};
+
+//The calling thread's arena, released when the thread exits
+HDRBufferArena & threadBufferArena();
+
+//Takes effect for blocks allocated afterwards
+void setBufferArenaUsesHugePages(bool useHugePages);
+
+//Process wide totals of every arena allocation so far
+HDRBufferArenaCounters bufferArenaCounters();
+
+#endif
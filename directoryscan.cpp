@@ -0,0 +1,228 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <ctype.h>
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#include "directoryscan.h"
+
+bool naturalFrameNameLess(const std::string & a, const std::string & b){
+    
+    size_t i = 0;
+    size_t j = 0;
+    
+    while (i < a.size() && j < b.size()) {
+        
+        if (isdigit((unsigned char)a[i]) && isdigit((unsigned char)b[j])) {
+            
+            //Compare the runs by value: skip leading zeros, then the longer run is larger, then digit by digit
+            while (i < a.size() && a[i] == '0') i++;
+            while (j < b.size() && b[j] == '0') j++;
+            
+            size_t runA = i;
+            size_t runB = j;
+            while (runA < a.size() && isdigit((unsigned char)a[runA])) runA++;
+            while (runB < b.size() && isdigit((unsigned char)b[runB])) runB++;
+            
+            if (runA - i != runB - j) {
+                return runA - i < runB - j;
+            }
+            
+            int order = a.compare(i, runA - i, b, j, runB - j);
+            if (order != 0) {
+                return order < 0;
+            }
+            
+            i = runA;
+            j = runB;
+            continue;
+        }
+        
+        int charA = tolower((unsigned char)a[i]);
+        int charB = tolower((unsigned char)b[j]);
+        if (charA != charB) {
+            return charA < charB;
+        }
+        i++;
+        j++;
+    }
+    
+    if ((a.size() - i) != (b.size() - j)) {
+        return (a.size() - i) < (b.size() - j);
+    }
+    
+    //Equal but for case or leading zeros, fall back to the bytes so the order is total
+    return a < b;
+}
+
+bool isFrameName(const char * name){
+    
+    const char * extension = strrchr(name, '.');
+    if (!extension) {
+        return false;
+    }
+    
+    return strcasecmp(extension, ".tif") == 0 || strcasecmp(extension, ".tiff") == 0 || strcasecmp(extension, ".exr") == 0;
+}
+
+HDRDirectoryScanner::HDRDirectoryScanner(const std::string & rootPath, int threadCount) : busyThreads(0), stopping(false) {
+    
+    root.reset(new Directory);
+    root->path = rootPath;
+    root->scanned = false;
+    
+    pending.push_back(root.get());
+    
+    Position position = {root.get(), 0};
+    positions.push_back(position);
+    
+    for (int i = 0; i < (threadCount > 0 ? threadCount : 1); i++) {
+        threads.push_back(std::thread(&HDRDirectoryScanner::scanDirectories, this));
+    }
+}
+
+HDRDirectoryScanner::~HDRDirectoryScanner(){
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    directoryQueued.notify_all();
+    
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+void HDRDirectoryScanner::scanDirectories(){
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    
+    while (true) {
+        
+        //Done when nothing is queued and no directory being read can queue more
+        directoryQueued.wait(lock, [&]{ return stopping || !pending.empty() || busyThreads == 0; });
+        if (stopping || pending.empty()) {
+            directoryQueued.notify_all();
+            return;
+        }
+        
+        Directory * directory = pending.back();
+        pending.pop_back();
+        busyThreads++;
+        
+        lock.unlock();
+        readDirectory(directory);
+        lock.lock();
+        
+        directory->scanned = true;
+        busyThreads--;
+        
+        //Subdirectories are pushed last to first, so the first is read first
+        for (size_t i = directory->children.size(); i > 0; i--) {
+            pending.push_back(directory->children[i - 1].get());
+        }
+        
+        directoryScanned.notify_all();
+        directoryQueued.notify_all();
+    }
+}
+
+void HDRDirectoryScanner::readDirectory(Directory * directory){
+    
+    DIR * handle = opendir(directory->path.c_str());
+    if (!handle) {
+        return;
+    }
+    
+    struct dirent * entry;
+    while ((entry = readdir(handle)) != NULL) {
+        
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        
+        bool isDirectory = false;
+        bool isFile = false;
+        
+#ifdef _DIRENT_HAVE_D_TYPE
+        isDirectory = entry->d_type == DT_DIR;
+        isFile = entry->d_type == DT_REG;
+        
+        //Links and file systems that don't fill in the type need a stat, links to files count as files
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+#endif
+        {
+            std::string path = directory->path + "/" + entry->d_name;
+            struct stat status;
+            if (lstat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode)) {
+                isDirectory = true;
+            } else if (stat(path.c_str(), &status) == 0 && S_ISREG(status.st_mode)) {
+                isFile = true;
+            }
+        }
+        
+        if (isDirectory) {
+            Directory * child = new Directory;
+            child->path = directory->path + "/" + entry->d_name;
+            child->scanned = false;
+            directory->children.push_back(std::unique_ptr<Directory>(child));
+            
+            Entry childEntry = {entry->d_name, child};
+            directory->entries.push_back(childEntry);
+        } else if (isFile && isFrameName(entry->d_name)) {
+            Entry frameEntry = {entry->d_name, NULL};
+            directory->entries.push_back(frameEntry);
+        }
+    }
+    
+    closedir(handle);
+    
+    std::sort(directory->entries.begin(), directory->entries.end(), [](const Entry & a, const Entry & b){
+        return naturalFrameNameLess(a.name, b.name);
+    });
+    
+    //Children in entry order, so they are queued in the order next() reaches them
+    std::sort(directory->children.begin(), directory->children.end(), [](const std::unique_ptr<Directory> & a, const std::unique_ptr<Directory> & b){
+        return naturalFrameNameLess(a->path, b->path);
+    });
+}
+
+bool HDRDirectoryScanner::next(std::string & path){
+    
+    while (!positions.empty()) {
+        
+        Position & position = positions.back();
+        Directory * directory = position.directory;
+        
+        if (position.entry == 0) {
+            std::unique_lock<std::mutex> lock(mutex);
+            directoryScanned.wait(lock, [&]{ return directory->scanned; });
+        }
+        
+        if (position.entry >= directory->entries.size()) {
+            positions.pop_back();
+            continue;
+        }
+        
+        const Entry & entry = directory->entries[position.entry++];
+        
+        if (entry.directory) {
+            Position child = {entry.directory, 0};
+            positions.push_back(child);
+            continue;
+        }
+        
+        path = directory->path + "/" + entry.name;
+        return true;
+    }
+    
+    return false;
+}
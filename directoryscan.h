@@ -0,0 +1,85 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef DIRECTORYSCAN
+#define DIRECTORYSCAN
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ Finds the TIFF and OpenEXR frames under a folder with a pool of threads that each read one directory at a time,
+ so the round trips of a network share overlap instead of adding up. Frames are handed out by next()
+ in a fixed order while the scan is still running: the entries of each directory, files and
+ subdirectories alike, are sorted by name with runs of digits compared as numbers (frame_9 before
+ frame_10), and a subdirectory's frames come in its place among them. next() only waits when the
+ directory it needs hasn't been read yet, and workers read directories in roughly the order next()
+ asks for them.
+
+ Like QDirIterator without FollowSymlinks, hidden entries are skipped and symbolic links to
+ directories are not followed. A directory that can't be read contributes no frames.
+ */
+
+#define DIRECTORY_SCAN_THREADS 8
+
+//Less than, with runs of digits compared by value and letters compared case insensitively
+bool naturalFrameNameLess(const std::string & a, const std::string & b);
+
+//Whether the name has a .tif, .tiff or .exr extension, in any case
+bool isFrameName(const char * name);
+
+class HDRDirectoryScanner {
+public:
+    HDRDirectoryScanner(const std::string & rootPath, int threadCount);
+    ~HDRDirectoryScanner();
+    
+    //The next frame path in scan order, waiting for the scan to reach it. False once every frame has been handed out.
+    bool next(std::string & path);
+    
+private:
+    HDRDirectoryScanner(const HDRDirectoryScanner &);
+    HDRDirectoryScanner & operator=(const HDRDirectoryScanner &);
+    
+    struct Directory;
+    
+    typedef struct {
+        std::string name;
+        Directory * directory;          //NULL for a frame
+    } Entry;
+    
+    struct Directory {
+        std::string path;
+        bool scanned;
+        std::vector<Entry> entries;     //In frame order once scanned
+        std::vector<std::unique_ptr<Directory> > children;
+    };
+    
+    typedef struct {
+        Directory * directory;
+        size_t entry;
+    } Position;
+    
+    void scanDirectories();
+    void readDirectory(Directory * directory);
+    
+    std::unique_ptr<Directory> root;
+    std::vector<std::thread> threads;
+    
+    std::mutex mutex;
+    std::condition_variable directoryScanned;
+    std::condition_variable directoryQueued;
+    std::vector<Directory *> pending;       //Popped from the back, pushed so the next one wanted is on top
+    int busyThreads;
+    bool stopping;
+    
+    std::vector<Position> positions;        //Where next() is in each directory it has entered, used by next() only
+};
+
+#endif
@@ -0,0 +1,106 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <vector>
+
+#include "fileidentity.h"
+
+bool fileIdentityForPath(const char * path, HDRFileIdentity * identity){
+    
+    struct stat status;
+    if (stat(path, &status) != 0) {
+        return false;
+    }
+    
+    identity->size = (uint64_t)status.st_size;
+    identity->inode = (uint64_t)status.st_ino;
+#ifdef __APPLE__
+    identity->modified = ((int64_t)status.st_mtimespec.tv_sec * 1000000000LL) + status.st_mtimespec.tv_nsec;
+#else
+    identity->modified = ((int64_t)status.st_mtim.tv_sec * 1000000000LL) + status.st_mtim.tv_nsec;
+#endif
+    
+    return true;
+}
+
+bool sameFileIdentity(const HDRFileIdentity & a, const HDRFileIdentity & b){
+    return a.size == b.size && a.modified == b.modified && a.inode == b.inode;
+}
+
+uint64_t hashFilePath(const char * path, size_t length){
+    
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)path[i];
+        hash *= 1099511628211ULL;
+    }
+    
+    return hash;
+}
+
+#define FILE_HASH_BLOCK_BYTES (4 * 1024 * 1024)
+
+static const uint64_t fileHashPrime1 = 11400714785074694791ULL;
+static const uint64_t fileHashPrime2 = 14029467366897019727ULL;
+static const uint64_t fileHashPrime3 = 1609587929392839161ULL;
+static const uint64_t fileHashPrime4 = 9650029242287828579ULL;
+
+static inline uint64_t rotateLeft(uint64_t value, int bits){
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t hashLane(uint64_t lane, uint64_t input){
+    return rotateLeft(lane + (input * fileHashPrime2), 31) * fileHashPrime1;
+}
+
+bool hashFileContents(const char * path, uint64_t * hash){
+    
+    FILE * file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    
+    //Four independent multiply-rotate lanes over 32 byte stripes, so the loop isn't bound by one multiply chain
+    uint64_t lanes[4] = {fileHashPrime1 + fileHashPrime2, fileHashPrime2, 0, 0 - fileHashPrime1};
+    uint64_t total = 0;
+    std::vector<unsigned char> block(FILE_HASH_BLOCK_BYTES);
+    
+    size_t length;
+    while ((length = fread(block.data(), 1, block.size(), file)) > 0) {
+        
+        //Only the last block can be short, pad it to whole stripes with zeros
+        size_t stripes = (length + 31) / 32;
+        memset(block.data() + length, 0, (stripes * 32) - length);
+        
+        for (size_t i = 0; i < stripes; i++) {
+            uint64_t input[4];
+            memcpy(input, block.data() + (i * 32), sizeof(input));
+            for (int lane = 0; lane < 4; lane++) {
+                lanes[lane] = hashLane(lanes[lane], input[lane]);
+            }
+        }
+        total += length;
+    }
+    
+    bool failed = ferror(file) != 0;
+    fclose(file);
+    if (failed) {
+        return false;
+    }
+    
+    uint64_t value = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+    value = (value ^ total) * fileHashPrime4;
+    value ^= value >> 33;
+    value *= fileHashPrime3;
+    value ^= value >> 29;
+    *hash = value;
+    
+    return true;
+}
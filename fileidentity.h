@@ -0,0 +1,35 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FILEIDENTITY
+#define FILEIDENTITY
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ What a file was when it was measured. A file whose size, modification time or inode has changed
+ since, for instance a frame re-rendered under the same name, is measured again on resume.
+ */
+
+typedef struct {
+    uint64_t size;
+    int64_t modified;       //Nanoseconds since the epoch
+    uint64_t inode;
+} HDRFileIdentity;
+
+//Returns false if the file can't be stat'ed
+bool fileIdentityForPath(const char * path, HDRFileIdentity * identity);
+
+bool sameFileIdentity(const HDRFileIdentity & a, const HDRFileIdentity & b);
+
+//64-bit FNV-1a of the full path
+uint64_t hashFilePath(const char * path, size_t length);
+
+//64-bit hash of every byte of the file, read in large blocks at disk speed. Returns false if a read fails.
+bool hashFileContents(const char * path, uint64_t * hash);
+
+#endif
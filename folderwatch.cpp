@@ -0,0 +1,203 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "folderwatch.h"
+#include "directoryscan.h"
+
+#ifdef __linux__
+#define FOLDER_WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR)
+#endif
+
+HDRFolderWatcher::HDRFolderWatcher() : inotifyDescriptor(-1), stopped(false) {
+    stopPipe[0] = -1;
+    stopPipe[1] = -1;
+}
+
+HDRFolderWatcher::~HDRFolderWatcher(){
+    
+    stop();
+    if (reader.joinable()) {
+        reader.join();
+    }
+    
+    if (inotifyDescriptor != -1) {
+        close(inotifyDescriptor);
+    }
+    if (stopPipe[0] != -1) {
+        close(stopPipe[0]);
+        close(stopPipe[1]);
+    }
+}
+
+bool HDRFolderWatcher::start(const std::string & rootPath){
+    
+#ifdef __linux__
+    inotifyDescriptor = inotify_init1(IN_CLOEXEC);
+    if (inotifyDescriptor == -1 || pipe(stopPipe) != 0) {
+        return false;
+    }
+    
+    //Frames already in the tree are left to the scan of the run, only new ones are queued
+    watchFolder(rootPath, false);
+    
+    reader = std::thread(&HDRFolderWatcher::readEvents, this);
+    return true;
+#else
+    (void)rootPath;
+    return false;
+#endif
+}
+
+void HDRFolderWatcher::stop(){
+    
+    if (stopPipe[1] != -1) {
+        char byte = 0;
+        ssize_t written = write(stopPipe[1], &byte, 1);
+        (void)written;
+    }
+}
+
+bool HDRFolderWatcher::next(std::string & path){
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    frameQueued.wait(lock, [&]{ return stopped || !frames.empty(); });
+    
+    if (stopped) {
+        return false;
+    }
+    
+    path = frames.front();
+    frames.pop_front();
+    queuedFrames.erase(path);
+    
+    return true;
+}
+
+void HDRFolderWatcher::queueFrame(const std::string & path){
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    if (queuedFrames.insert(path).second) {
+        frames.push_back(path);
+        frameQueued.notify_one();
+    }
+}
+
+void HDRFolderWatcher::watchFolder(const std::string & path, bool queueFrames){
+    
+#ifdef __linux__
+    //Watched before it is read, so nothing landing in between is missed
+    int descriptor = inotify_add_watch(inotifyDescriptor, path.c_str(), FOLDER_WATCH_EVENTS);
+    if (descriptor == -1) {
+        return;
+    }
+    
+    folders[descriptor] = path;
+    
+    DIR * handle = opendir(path.c_str());
+    if (!handle) {
+        return;
+    }
+    
+    struct dirent * entry;
+    while ((entry = readdir(handle)) != NULL) {
+        
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        
+        std::string entryPath = path + "/" + entry->d_name;
+        struct stat status;
+        if (lstat(entryPath.c_str(), &status) != 0) {
+            continue;
+        }
+        
+        if (S_ISDIR(status.st_mode)) {
+            watchFolder(entryPath, queueFrames);
+        } else if (queueFrames && S_ISREG(status.st_mode) && isFrameName(entry->d_name)) {
+            queueFrame(entryPath);
+        }
+    }
+    
+    closedir(handle);
+#else
+    (void)path;
+    (void)queueFrames;
+#endif
+}
+
+void HDRFolderWatcher::readEvents(){
+    
+#ifdef __linux__
+    //Aligned for struct inotify_event, large enough for a burst of frames landing at once
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    
+    struct pollfd descriptors[2] = {{inotifyDescriptor, POLLIN, 0}, {stopPipe[0], POLLIN, 0}};
+    
+    while (true) {
+        
+        if (poll(descriptors, 2, -1) < 0) {
+            continue;
+        }
+        
+        if (descriptors[1].revents) {
+            break;
+        }
+        
+        ssize_t length = read(inotifyDescriptor, buffer, sizeof(buffer));
+        if (length <= 0) {
+            continue;
+        }
+        
+        for (char * position = buffer; position < buffer + length; ) {
+            
+            const struct inotify_event * event = (const struct inotify_event *)position;
+            position += sizeof(struct inotify_event) + event->len;
+            
+            if (event->mask & IN_Q_OVERFLOW) {
+                fprintf(stderr, "Too many frames landed at once, some were missed and need a rescan\n");
+                continue;
+            }
+            
+            //The folder was removed or moved away
+            if (event->mask & IN_IGNORED) {
+                folders.erase(event->wd);
+                continue;
+            }
+            
+            std::map<int, std::string>::const_iterator folder = folders.find(event->wd);
+            if (folder == folders.end() || event->len == 0 || event->name[0] == '.') {
+                continue;
+            }
+            
+            std::string path = folder->second + "/" + event->name;
+            
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    watchFolder(path, true);
+                }
+            } else if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) && isFrameName(event->name)) {
+                queueFrame(path);
+            }
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+    frameQueued.notify_all();
+#endif
+}
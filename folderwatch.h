@@ -0,0 +1,62 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FOLDERWATCH
+#define FOLDERWATCH
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+/*
+ Watches a folder and its subfolders for TIFF and OpenEXR frames that finish landing, through inotify (Linux only).
+ A frame is queued when a writer closes it after writing, or when it is renamed or moved into the
+ tree, which is how most renderers publish a finished frame. Folders created later are watched as
+ they appear, and the frames already in them are queued.
+
+ A frame that lands again while still queued is queued once. next() hands frames out in the order
+ they landed and waits for the next one, until stop() is called, which is safe from a signal handler.
+ */
+
+class HDRFolderWatcher {
+public:
+    HDRFolderWatcher();
+    ~HDRFolderWatcher();
+    
+    //Starts watching every folder under rootPath. Returns false if inotify isn't available.
+    bool start(const std::string & rootPath);
+    
+    //The next frame to land, waiting for it. False once stopped.
+    bool next(std::string & path);
+    
+    //Async signal safe
+    void stop();
+    
+private:
+    HDRFolderWatcher(const HDRFolderWatcher &);
+    HDRFolderWatcher & operator=(const HDRFolderWatcher &);
+    
+    void readEvents();
+    void watchFolder(const std::string & path, bool queueFrames);
+    void queueFrame(const std::string & path);
+    
+    int inotifyDescriptor;
+    int stopPipe[2];
+    std::thread reader;
+    std::map<int, std::string> folders;     //By watch descriptor, used by the reader thread only
+    
+    std::mutex mutex;
+    std::condition_variable frameQueued;
+    std::deque<std::string> frames;
+    std::set<std::string> queuedFrames;
+    bool stopped;
+};
+
+#endif
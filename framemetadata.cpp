@@ -0,0 +1,314 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <string.h>
+
+#include "framemetadata.h"
+#include "activedimensions.h"
+#include "adaptivearea.h"
+#include "pixelrows.h"
+#include "previewsampling.h"
+#include "scanlinestrips.h"
+#include "tiffmapping.h"
+
+OIIO_NAMESPACE_USING
+
+//Opens the image and checks the area against it, filling in a zero height. Returns NULL and sets failure on error.
+static ImageInput * openImageForActiveArea(const char * path, HDRActiveArea & area, HDRMetaDataResult & failure){
+    
+    ImageInput *in = ImageInput::open (path);
+    if (!in){
+        failure = CANT_OPEN_FILE;
+        return NULL;
+    }
+    
+    const ImageSpec &spec = in->spec();
+    
+    if (spec.nchannels < SCANLINE_STRIP_CHANNELS) {
+        closeImageInput(in);
+        failure = CANT_OPEN_FILE;
+        return NULL;
+    }
+    
+    if ((area.height + area.y) > spec.height) {
+        closeImageInput(in);
+        failure = INVALID_ACTIVE_AREA;
+        return NULL;
+    }
+    
+    if (area.height == 0) { area.height = spec.height;}
+    if (area.width == 0) {  area.width = spec.width;}
+    
+    return in;
+}
+
+static HDRMetaDataResult metadataResultForAccumulator(const HDRLightLevelAccumulator & accumulator, const float * lookupTable, int xres, int y, int yres){
+    
+    HDRLightLevels levels = lightLevelsForAccumulator(accumulator, lookupTable, xres, y, yres);
+    
+    HDRMetaDataResult result = {levels.maxFALL, levels.maxCLL, levels.maxPixelCLL, levels.activeY, levels.activeHeight};
+    memcpy(result.luminanceHistogram, accumulator.luminanceHistogram, sizeof(result.luminanceHistogram));
+    return result;
+}
+
+//Reduces the rows of area on an open image, which is left open. With adaptiveArea the letterbox rows inside area are left out.
+HDRMetaDataResult calculateMetadataForImage(ImageInput * in, const HDRLightLevelKernel & kernel, HDRActiveArea area, bool adaptiveArea){
+    
+    int xres = in->spec().width;
+    
+    //Only the active area rows are decoded, a strip at a time, and each strip is reduced as it arrives.
+    //Rows are reduced left to right, 8 pixels at a time when the CPU supports it
+    HDRLightLevelAccumulator accumulator;
+    resetLightLevelAccumulator(&accumulator);
+    HDRAdaptiveAreaReducer adaptiveReducer(kernel, xres, &accumulator);
+    
+    bool readAllRows = forEachScanlineInStrips(in, area.y, area.y + area.height, threadBufferArena(), [&](const uint16_t * row, int y){
+        if (adaptiveArea) {
+            adaptiveReducer.reduceRow(row, y);
+        } else {
+            kernel.reduceRow(row, xres, kernel.lookupTable, &accumulator);
+        }
+    }, kernel.sceneLinear);
+    
+    if (!readAllRows) {
+        return CANT_OPEN_FILE;
+    }
+    
+    std::pair<int, int> rows = adaptiveArea ? adaptiveReducer.finish(area.height) : std::make_pair(0, area.height);
+    return metadataResultForAccumulator(accumulator, kernel.lookupTable, xres, area.y + rows.first, rows.second);
+}
+
+//Estimates the light levels of area on an open image from a sample of its strips, see previewsampling.h. The image is left open.
+HDRMetaDataResult calculatePreviewMetadataForImage(ImageInput * in, const HDRLightLevelKernel & kernel, HDRActiveArea area){
+    
+    int xres = in->spec().width;
+    int stripHeight = previewStripHeight(in->spec().get_int_attribute("tiff:RowsPerStrip", 1));
+    
+    //Strips stay on multiples of the strip height counted from row 0, in line with the file's own
+    int firstStrip = area.y / stripHeight;
+    int stripCount = ((area.y + area.height - 1) / stripHeight) - firstStrip + 1;
+    
+    HDRLightLevelAccumulator accumulator;
+    resetLightLevelAccumulator(&accumulator);
+    HDRPreviewSample sample;
+    resetPreviewSample(&sample, stripCount);
+    int sampledRows = 0;
+    
+    for (int i = 0; i < stripCount; i++) {
+        
+        if (!previewSamplesStrip(i, stripCount)) {
+            continue;
+        }
+        
+        int stripBegin = (firstStrip + i) * stripHeight > area.y ? (firstStrip + i) * stripHeight : area.y;
+        int stripEnd = (firstStrip + i + 1) * stripHeight < area.y + area.height ? (firstStrip + i + 1) * stripHeight : area.y + area.height;
+        
+        //The strip's share of the sum, from the lanes folded before and after it
+        double sumBefore = lightLevelMaxComponentSum(&accumulator);
+        
+        bool readStrip = forEachScanlineInStrips(in, stripBegin, stripEnd, threadBufferArena(), [&](const uint16_t * row, int y){
+            kernel.reduceRow(row, xres, kernel.lookupTable, &accumulator);
+        }, kernel.sceneLinear);
+        
+        if (!readStrip) {
+            return CANT_OPEN_FILE;
+        }
+        
+        addStripToPreviewSample(&sample, (lightLevelMaxComponentSum(&accumulator) - sumBefore) / ((double)xres * (stripEnd - stripBegin)));
+        sampledRows += stripEnd - stripBegin;
+    }
+    
+    HDRMetaDataResult result = metadataResultForAccumulator(accumulator, kernel.lookupTable, xres, area.y, sampledRows);
+    result.activeHeight = area.height;
+    result.maxFALLStandardError = 10000.0 * previewStandardError(&sample);
+    
+    return result;
+}
+
+//Reduces the rows of area where they lie in a mapped file, see tiffmapping.h
+static HDRMetaDataResult calculateMetadataForMappedTiff(const HDRMappedTiff * tiff, const HDRLightLevelKernel & kernel, HDRActiveArea area, bool adaptiveArea){
+    
+    if ((area.height + area.y) > tiff->height) {
+        return INVALID_ACTIVE_AREA;
+    }
+    if (area.height == 0) { area.height = tiff->height;}
+    
+    HDRLightLevelKernel fileKernel = kernel;
+    if (tiff->byteSwapped) {
+        fileKernel.reduceRow = kernel.reduceByteSwappedRow;
+    }
+    
+    adviseMappedTiffRows(tiff, area.y, area.y + area.height);
+    
+    HDRLightLevelAccumulator accumulator;
+    resetLightLevelAccumulator(&accumulator);
+    HDRAdaptiveAreaReducer adaptiveReducer(fileKernel, tiff->width, &accumulator);
+    
+    for (int y = 0; y < area.height; y++) {
+        const uint16_t * row = mappedTiffRow(tiff, area.y + y);
+        if (adaptiveArea) {
+            adaptiveReducer.reduceRow(row, y);
+        } else {
+            fileKernel.reduceRow(row, tiff->width, fileKernel.lookupTable, &accumulator);
+        }
+    }
+    
+    std::pair<int, int> rows = adaptiveArea ? adaptiveReducer.finish(area.height) : std::make_pair(0, area.height);
+    return metadataResultForAccumulator(accumulator, kernel.lookupTable, tiff->width, area.y + rows.first, rows.second);
+}
+
+HDRMetaDataResult calculateMetadataForPath(const char * path, const HDRLightLevelKernel & kernel, HDRActiveArea area, bool adaptiveArea, bool preview){
+    
+    uint64_t start = monotonicNanoseconds();
+    
+    HDRFileIdentity identity = {0, 0, 0};
+    fileIdentityForPath(path, &identity);
+    
+    HDRMappedTiff tiff;
+    if (!preview && !kernel.sceneLinear && mappedTiffReadsEnabled() && mapUncompressedTiff(path, &tiff)) {
+        
+        uint64_t mapped = monotonicNanoseconds();
+        
+        HDRMetaDataResult result = calculateMetadataForMappedTiff(&tiff, kernel, area, adaptiveArea);
+        result.fileIdentity = identity;
+        unmapUncompressedTiff(&tiff);
+        
+        //Pages are read in as the kernel first touches them, so reading is counted as computing here
+        result.timings.openNanoseconds = mapped - start;
+        result.timings.computeNanoseconds = monotonicNanoseconds() - mapped;
+        result.timings.measured = true;
+        
+        return result;
+    }
+    
+    HDRMetaDataResult failure;
+    ImageInput *in = openImageForActiveArea(path, area, failure);
+    if (!in){
+        return failure;
+    }
+    
+    uint64_t opened = monotonicNanoseconds();
+    uint64_t readBefore = threadReadNanoseconds();
+    
+    HDRMetaDataResult result = preview ? calculatePreviewMetadataForImage(in, kernel, area) : calculateMetadataForImage(in, kernel, area, adaptiveArea);
+    result.fileIdentity = identity;
+    closeImageInput(in);
+    
+    result.timings.openNanoseconds = opened - start;
+    result.timings.decodeNanoseconds = threadReadNanoseconds() - readBefore;
+    result.timings.computeNanoseconds = (monotonicNanoseconds() - opened) - result.timings.decodeNanoseconds;
+    result.timings.measured = true;
+    
+    return result;
+}
+
+//Finds the active rows of a sampled file and, while it is open, measures it as the main run would if those rows are chosen
+HDRActiveAreaProbe probeActiveAreaForPath(const char * path, const HDRLightLevelKernel & kernel, bool preview){
+    
+    HDRActiveAreaProbe probe;
+    uint64_t start = monotonicNanoseconds();
+    
+    HDRFileIdentity identity = {0, 0, 0};
+    fileIdentityForPath(path, &identity);
+    
+    ImageInput *in = ImageInput::open (path);
+    if (!in){
+        probe.dimensions = std::make_pair(0, 0);
+        probe.result = CANT_OPEN_FILE;
+        return probe;
+    }
+    
+    uint64_t opened = monotonicNanoseconds();
+    
+    probe.dimensions = getActiveAreaDimensionsForImage(in, kernel.sceneLinear);
+    
+    if (probe.dimensions.second > 0) {
+        
+        //Timed like calculateMetadataForPath, finding the rows isn't part of measuring the frame
+        uint64_t measureStart = monotonicNanoseconds();
+        uint64_t readBefore = threadReadNanoseconds();
+        
+        HDRActiveArea area = {0, probe.dimensions.first, 0, probe.dimensions.second};
+        probe.result = preview ? calculatePreviewMetadataForImage(in, kernel, area) : calculateMetadataForImage(in, kernel, area, false);
+        probe.result.fileIdentity = identity;
+        
+        probe.result.timings.openNanoseconds = opened - start;
+        probe.result.timings.decodeNanoseconds = threadReadNanoseconds() - readBefore;
+        probe.result.timings.computeNanoseconds = (monotonicNanoseconds() - measureStart) - probe.result.timings.decodeNanoseconds;
+        probe.result.timings.measured = true;
+    } else {
+        probe.result = INVALID_ACTIVE_AREA;
+    }
+    
+    closeImageInput(in);
+    
+    return probe;
+}
+
+//I/O stage of the pipelined mode: decodes the whole active area into a pooled frame buffer
+void loadActiveAreaForPath(const char * path, HDRActiveArea area, bool sceneLinear, HDRFrameBuffer & frame){
+    
+    frame.loaded = false;
+    memset(&frame.timings, 0, sizeof(frame.timings));
+    uint64_t start = monotonicNanoseconds();
+    
+    HDRFileIdentity identity = {0, 0, 0};
+    fileIdentityForPath(path, &identity);
+    frame.identity = identity;
+    
+    ImageInput *in = openImageForActiveArea(path, area, frame.status);
+    if (!in){
+        return;
+    }
+    
+    uint64_t opened = monotonicNanoseconds();
+    
+    frame.y = area.y;
+    frame.width = in->spec().width;
+    frame.height = area.height;
+    frame.pixels = frame.arena.reservePixels((size_t)frame.width * frame.height * SCANLINE_STRIP_CHANNELS);
+    
+    frame.loaded = frame.pixels && readScanlineStrip(in, area.y, area.y + area.height, sceneLinear, frame.pixels);
+    if (!frame.loaded) {
+        frame.status = CANT_OPEN_FILE;
+    }
+    
+    closeImageInput(in);
+    
+    frame.timings.openNanoseconds = opened - start;
+    frame.timings.decodeNanoseconds = monotonicNanoseconds() - opened;
+    frame.timings.measured = frame.loaded;
+}
+
+//Compute stage of the pipelined mode
+HDRMetaDataResult calculateMetadataForFrameBuffer(const HDRFrameBuffer & frame, const HDRLightLevelKernel & kernel, bool adaptiveArea){
+    
+    if (!frame.loaded) {
+        return frame.status;
+    }
+    
+    uint64_t start = monotonicNanoseconds();
+    
+    HDRPixelRegion activeRegion = pixelRegionForFrame(frame.pixels, frame.width, SCANLINE_STRIP_CHANNELS, 0, 0, frame.width, frame.height);
+    HDRLightLevelAccumulator accumulator;
+    resetLightLevelAccumulator(&accumulator);
+    HDRAdaptiveAreaReducer adaptiveReducer(kernel, frame.width, &accumulator);
+    
+    forEachPixelRow(activeRegion, [&](const uint16_t * row, int y){
+        if (adaptiveArea) {
+            adaptiveReducer.reduceRow(row, y);
+        } else {
+            kernel.reduceRow(row, frame.width, kernel.lookupTable, &accumulator);
+        }
+    });
+    
+    std::pair<int, int> rows = adaptiveArea ? adaptiveReducer.finish(frame.height) : std::make_pair(0, frame.height);
+    HDRMetaDataResult result = metadataResultForAccumulator(accumulator, kernel.lookupTable, frame.width, frame.y + rows.first, rows.second);
+    result.fileIdentity = frame.identity;
+    result.timings = frame.timings;
+    result.timings.computeNanoseconds = monotonicNanoseconds() - start;
+    return result;
+}
@@ -0,0 +1,90 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FRAMEMETADATA
+#define FRAMEMETADATA
+
+#include <stdint.h>
+
+#include <utility>
+
+#include <OpenImageIO/imageio.h>
+
+#include "bufferarena.h"
+#include "fileidentity.h"
+#include "lightlevelmeter.h"
+#include "luminancekernel.h"
+#include "stagetiming.h"
+
+/*
+ Measures the light levels of one frame: the rows of its active area are read a strip at a time and
+ reduced by the light level kernel. These are the per frame steps of the generator, kept apart from
+ its job handling so the benchmark times the same code.
+ */
+
+typedef struct {
+    double maxFALL;
+    double maxCLL;
+    double maxPixelCLL;     //maxCLL of the brightest 99.9% of pixels
+    int activeY;            //Rows the values were measured over
+    int activeHeight;
+    HDRFileIdentity fileIdentity;   //Of the file as it was opened
+    bool resumed;           //Taken from the journal of an earlier run instead of measured
+    bool cached;            //Taken from the result cache instead of measured
+    uint64_t cacheKey;      //Under which a measured result goes into the cache, 0 for none
+    double maxFALLStandardError;    //Of a --preview estimate, 0 when every row was measured
+    HDRFrameTimings timings;
+    uint32_t luminanceHistogram[HDR_LUMINANCE_HISTOGRAM_BINS];     //Only filled in with --histogram
+} HDRMetaDataResult;
+
+#define CANT_OPEN_FILE {-1., -1., -1.}
+#define INVALID_ACTIVE_AREA {-2., -2., -2.}
+
+typedef struct {
+    int x;      //These are ignored for now
+    int y;
+    int width;  //These are ignored for now
+    int height;
+} HDRActiveArea;
+
+typedef struct {
+    std::pair<int, int> dimensions;     //Active rows (y, height) as found by getActiveAreaDimensionsForImage
+    HDRMetaDataResult result;           //Measured over those rows while the file was open
+} HDRActiveAreaProbe;
+
+typedef struct {
+    HDRBufferArena arena;           //Owns the pixels, reused from frame to frame
+    uint16_t * pixels;              //RGB rows of the active area, half floats for a scene-linear kernel
+    HDRFileIdentity identity;
+    uint64_t cacheKey;
+    int y;
+    int width;
+    int height;
+    bool loaded;
+    HDRMetaDataResult status;       //Why the load failed when loaded is false
+    HDRFrameTimings timings;        //Of the load, the compute stage adds its own
+} HDRFrameBuffer;
+
+//Reduces the rows of area on an open image, which is left open. With adaptiveArea the letterbox rows inside area are left out.
+HDRMetaDataResult calculateMetadataForImage(OIIO::ImageInput * in, const HDRLightLevelKernel & kernel, HDRActiveArea area, bool adaptiveArea);
+
+//Estimates the light levels of area on an open image from a sample of its strips, see previewsampling.h. The image is left open.
+HDRMetaDataResult calculatePreviewMetadataForImage(OIIO::ImageInput * in, const HDRLightLevelKernel & kernel, HDRActiveArea area);
+
+//A zero area height measures the whole frame. Uncompressed 16-bit RGB TIFFs are read in place, see tiffmapping.h, except for a preview or a scene-linear kernel.
+HDRMetaDataResult calculateMetadataForPath(const char * path, const HDRLightLevelKernel & kernel, HDRActiveArea area, bool adaptiveArea, bool preview);
+
+//Finds the active rows of a sampled file and, while it is open, measures it as the main run would if those rows are chosen,
+//with the sampled estimate of calculatePreviewMetadataForImage for a preview
+HDRActiveAreaProbe probeActiveAreaForPath(const char * path, const HDRLightLevelKernel & kernel, bool preview);
+
+//I/O stage of the pipelined mode: decodes the whole active area into a pooled frame buffer, as half floats with sceneLinear
+void loadActiveAreaForPath(const char * path, HDRActiveArea area, bool sceneLinear, HDRFrameBuffer & frame);
+
+//Compute stage of the pipelined mode
+HDRMetaDataResult calculateMetadataForFrameBuffer(const HDRFrameBuffer & frame, const HDRLightLevelKernel & kernel, bool adaptiveArea);
+
+#endif
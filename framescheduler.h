@@ -0,0 +1,284 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FRAMESCHEDULER
+#define FRAMESCHEDULER
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ Persistent worker pools for processing frames. Workers pull the next job from a shared source as soon
+ as they are free, so a slow frame only holds up the thread it is running on.
+
+ Jobs are numbered in the order they are pulled and their results go into a reorder buffer of
+ reorderWindow slots, from which the calling thread emits them strictly in job order. No job is pulled
+ more than reorderWindow ahead of the next result to emit, which bounds memory on any reel length.
+
+ nextJob(job) is called by one thread at a time and returns false when there are no more jobs.
+ emit(job, result) runs on the calling thread only.
+ */
+
+template <typename Job, typename Result>
+class HDRFrameReorderBuffer {
+public:
+
+    HDRFrameReorderBuffer(int reorderWindow, int producerCount) : slots(reorderWindow), nextSequence(0), emitSequence(0), sourceExhausted(false), runningProducers(producerCount) {
+        for (size_t i = 0; i < slots.size(); i++) {
+            slots[i].ready = false;
+        }
+    }
+
+    //Pulls and numbers the next job, waiting while the window is full. Returns false once the source is exhausted.
+    template <typename NextJobFunction>
+    bool pullJob(NextJobFunction & nextJob, Job & job, long long & sequence){
+
+        std::unique_lock<std::mutex> sourceLock(sourceMutex);
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            windowOpen.wait(lock, [&](){ return sourceExhausted || nextSequence < emitSequence + (long long)slots.size(); });
+            if (sourceExhausted) {
+                return false;
+            }
+        }
+
+        bool hasJob = nextJob(job);
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        if (!hasJob) {
+            sourceExhausted = true;
+            windowOpen.notify_all();
+            return false;
+        }
+
+        sequence = nextSequence++;
+        return true;
+    }
+
+    void store(long long sequence, const Job & job, const Result & result){
+        std::unique_lock<std::mutex> lock(stateMutex);
+        Slot & slot = slots[sequence % slots.size()];
+        slot.job = job;
+        slot.result = result;
+        slot.ready = true;
+        if (sequence == emitSequence) {
+            resultReady.notify_one();
+        }
+    }
+
+    //Called by every thread that stores results once it has stored its last one
+    void producerFinished(){
+        std::unique_lock<std::mutex> lock(stateMutex);
+        runningProducers--;
+        resultReady.notify_one();
+    }
+
+    //Emits results in job order until every producer has finished
+    template <typename EmitFunction>
+    void emitInOrder(EmitFunction & emit){
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+
+        while (true) {
+
+            Slot & slot = slots[emitSequence % slots.size()];
+
+            if (slot.ready) {
+                Job job = slot.job;
+                Result result = slot.result;
+                slot.ready = false;
+                emitSequence++;
+                windowOpen.notify_all();
+
+                lock.unlock();
+                emit(job, result);
+                lock.lock();
+                continue;
+            }
+
+            if (runningProducers == 0) {
+                break;
+            }
+
+            resultReady.wait(lock);
+        }
+    }
+
+private:
+
+    typedef struct {
+        bool ready;
+        Job job;
+        Result result;
+    } Slot;
+
+    std::vector<Slot> slots;
+    std::mutex sourceMutex;     //Serializes nextJob and numbering
+    std::mutex stateMutex;      //Guards the slots and the counters below
+    std::condition_variable windowOpen;
+    std::condition_variable resultReady;
+    long long nextSequence;
+    long long emitSequence;
+    bool sourceExhausted;
+    int runningProducers;
+};
+
+//Single stage: every worker loads and computes its own job. compute(job) returns the result.
+template <typename Job, typename Result, typename NextJobFunction, typename ComputeFunction, typename EmitFunction>
+void processFramesInOrder(int threadCount, int reorderWindow, NextJobFunction nextJob, ComputeFunction compute, EmitFunction emit){
+
+    if (threadCount < 1) { threadCount = 1; }
+    if (reorderWindow < threadCount) { reorderWindow = threadCount; }
+
+    HDRFrameReorderBuffer<Job, Result> reorderBuffer(reorderWindow, threadCount);
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < threadCount; i++) {
+        workers.push_back(std::thread([&](){
+            Job job;
+            long long sequence = 0;
+            while (reorderBuffer.pullJob(nextJob, job, sequence)) {
+                reorderBuffer.store(sequence, job, compute(job));
+            }
+            reorderBuffer.producerFinished();
+        }));
+    }
+
+    reorderBuffer.emitInOrder(emit);
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+/*
+ Two stages: I/O threads load jobs into a fixed pool of frameBufferCount reusable frames and compute
+ threads reduce the loaded frames. An I/O thread needs a free frame before it pulls a job, and a frame
+ only becomes free again once it has been computed, so a stalled compute stage holds back I/O and vice versa.
+
+ load(job, frame) fills a frame and compute(job, frame) returns the result. Frames are reused as they
+ are, so a load that resizes its buffers only allocates while the pool warms up.
+ */
+
+template <typename Job, typename Frame>
+class HDRFramePool {
+public:
+
+    typedef struct {
+        long long sequence;
+        Job job;
+        int frameIndex;
+    } LoadedFrame;
+
+    HDRFramePool(int frameBufferCount, int loaderCount) : frames(frameBufferCount), runningLoaders(loaderCount) {
+        for (int i = 0; i < frameBufferCount; i++) {
+            freeFrames.push_back(i);
+        }
+    }
+
+    Frame & frame(int frameIndex){
+        return frames[frameIndex];
+    }
+
+    int acquireFreeFrame(){
+        std::unique_lock<std::mutex> lock(mutex);
+        frameFree.wait(lock, [&](){ return !freeFrames.empty(); });
+        int frameIndex = freeFrames.back();
+        freeFrames.pop_back();
+        return frameIndex;
+    }
+
+    void releaseFrame(int frameIndex){
+        std::unique_lock<std::mutex> lock(mutex);
+        freeFrames.push_back(frameIndex);
+        frameFree.notify_one();
+    }
+
+    void pushLoadedFrame(const LoadedFrame & loadedFrame){
+        std::unique_lock<std::mutex> lock(mutex);
+        loadedFrames.push_back(loadedFrame);
+        frameLoaded.notify_one();
+    }
+
+    //Returns false when nothing is loaded and every loader has finished
+    bool popLoadedFrame(LoadedFrame & loadedFrame){
+        std::unique_lock<std::mutex> lock(mutex);
+        frameLoaded.wait(lock, [&](){ return !loadedFrames.empty() || runningLoaders == 0; });
+        if (loadedFrames.empty()) {
+            return false;
+        }
+        loadedFrame = loadedFrames.front();
+        loadedFrames.pop_front();
+        return true;
+    }
+
+    void loaderFinished(){
+        std::unique_lock<std::mutex> lock(mutex);
+        runningLoaders--;
+        frameLoaded.notify_all();
+    }
+
+private:
+    std::vector<Frame> frames;
+    std::vector<int> freeFrames;
+    std::deque<LoadedFrame> loadedFrames;
+    std::mutex mutex;
+    std::condition_variable frameFree;
+    std::condition_variable frameLoaded;
+    int runningLoaders;
+};
+
+template <typename Job, typename Frame, typename Result, typename NextJobFunction, typename LoadFunction, typename ComputeFunction, typename EmitFunction>
+void processFramesInOrderPipelined(int ioThreadCount, int computeThreadCount, int frameBufferCount, int reorderWindow, NextJobFunction nextJob, LoadFunction load, ComputeFunction compute, EmitFunction emit){
+
+    if (ioThreadCount < 1) { ioThreadCount = 1; }
+    if (computeThreadCount < 1) { computeThreadCount = 1; }
+    if (frameBufferCount < ioThreadCount + computeThreadCount) { frameBufferCount = ioThreadCount + computeThreadCount; }
+    if (reorderWindow < frameBufferCount) { reorderWindow = frameBufferCount; }
+
+    HDRFrameReorderBuffer<Job, Result> reorderBuffer(reorderWindow, computeThreadCount);
+    HDRFramePool<Job, Frame> framePool(frameBufferCount, ioThreadCount);
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < ioThreadCount; i++) {
+        workers.push_back(std::thread([&](){
+            while (true) {
+                typename HDRFramePool<Job, Frame>::LoadedFrame loadedFrame;
+                loadedFrame.frameIndex = framePool.acquireFreeFrame();
+                if (!reorderBuffer.pullJob(nextJob, loadedFrame.job, loadedFrame.sequence)) {
+                    framePool.releaseFrame(loadedFrame.frameIndex);
+                    break;
+                }
+                load(loadedFrame.job, framePool.frame(loadedFrame.frameIndex));
+                framePool.pushLoadedFrame(loadedFrame);
+            }
+            framePool.loaderFinished();
+        }));
+    }
+
+    for (int i = 0; i < computeThreadCount; i++) {
+        workers.push_back(std::thread([&](){
+            typename HDRFramePool<Job, Frame>::LoadedFrame loadedFrame;
+            while (framePool.popLoadedFrame(loadedFrame)) {
+                Result result = compute(loadedFrame.job, framePool.frame(loadedFrame.frameIndex));
+                framePool.releaseFrame(loadedFrame.frameIndex);
+                reorderBuffer.store(loadedFrame.sequence, loadedFrame.job, result);
+            }
+            reorderBuffer.producerFinished();
+        }));
+    }
+
+    reorderBuffer.emitInOrder(emit);
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+#endif
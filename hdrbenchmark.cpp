@@ -0,0 +1,206 @@
+//
+//  hdrbenchmark.cpp
+//  HDR GENERATOR TOOL
+//
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+#include "luminancekernel.h"
+#include "pixelrows.h"
+#include "pqlookup.h"
+
+/*
+
+ HDR BENCHMARK
+ Measures the pixel loops of the generator on synthetic in-memory frames so that changes to the
+ traversal can be compared without touching storage. Every pass reads the whole frame once; the
+ reported bandwidth is frame bytes divided by the time of one pass.
+
+ The kernel section times the light level kernel alone on every ISA the CPU supports, over noisy
+ frames and over flat ones, where every pixel lands in the same histogram bin.
+
+ The lookup table section compares building the PQ table for every frame, as the generator used to,
+ with fetching the process wide shared table.
+ */
+
+#define BENCHMARK_CHANNELS 3
+#define BENCHMARK_PASSES 5
+#define BENCHMARK_LOOKUP_FRAMES 1000
+#define BENCHMARK_FLAT_CODE 30000
+
+typedef struct {
+    const char * name;
+    int width;
+    int height;
+} HDRBenchmarkFrameSize;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::vector<uint16_t> syntheticFrame(int width, int height){
+    std::vector<uint16_t> pixels((size_t)width * height * BENCHMARK_CHANNELS);
+    uint32_t state = 0x2545F491;
+    for (size_t i = 0; i < pixels.size(); i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        pixels[i] = (uint16_t)state;
+    }
+    return pixels;
+}
+
+//The traversal the pixel loops used before, x outside and y inside
+static uint64_t maxComponentSumColumnMajor(const HDRPixelRegion & region){
+    uint64_t sum = 0;
+    for (int x = 0; x < region.width; x++) {
+        for (int y = 0; y < region.height; y++) {
+            const uint16_t * pixel = pixelRegionRow(region, y) + (x * region.channels);
+            uint16_t maxComponent = pixel[0] > pixel[1] ? pixel[0] : pixel[1];
+            sum += maxComponent > pixel[2] ? maxComponent : pixel[2];
+        }
+    }
+    return sum;
+}
+
+static uint64_t maxComponentSumRowMajor(const HDRPixelRegion & region){
+    uint64_t sum = 0;
+    forEachPixelRow(region, [&](const uint16_t * row, int){
+        for (const uint16_t * pixel = row; pixel < row + (region.width * region.channels); pixel += region.channels) {
+            uint16_t maxComponent = pixel[0] > pixel[1] ? pixel[0] : pixel[1];
+            sum += maxComponent > pixel[2] ? maxComponent : pixel[2];
+        }
+    });
+    return sum;
+}
+
+template <typename Traversal>
+static double benchmarkTraversal(const HDRPixelRegion & region, Traversal traversal, uint64_t * checksum){
+    double best = 0.0;
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        *checksum = traversal(region);
+        double elapsed = millisecondsSince(start);
+        if (pass == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+static double benchmarkKernel(const HDRPixelRegion & region, HDRLightLevelRowFunction reduceRow, const float * lookupTable, HDRLightLevelAccumulator * accumulator){
+    double best = 0.0;
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+        resetLightLevelAccumulator(accumulator);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        forEachPixelRow(region, [&](const uint16_t * row, int){
+            reduceRow(row, region.width, lookupTable, accumulator);
+        });
+        double elapsed = millisecondsSince(start);
+        if (pass == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+int main(int argc, const char * argv[]) {
+
+    HDRBenchmarkFrameSize sizes[] = {
+        {"4K DCI", 4096, 2160},
+        {"8K", 8192, 4320}
+    };
+
+    printf("%-8s %-14s %12s %12s\n", "frame", "traversal", "ms/frame", "GB/s");
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+
+        std::vector<uint16_t> pixels = syntheticFrame(sizes[i].width, sizes[i].height);
+        HDRPixelRegion region = pixelRegionForFrame(pixels.data(), sizes[i].width, BENCHMARK_CHANNELS, 0, 0, sizes[i].width, sizes[i].height);
+        double frameBytes = (double)pixels.size() * sizeof(uint16_t);
+
+        uint64_t columnChecksum = 0, rowChecksum = 0;
+        double columnMajor = benchmarkTraversal(region, maxComponentSumColumnMajor, &columnChecksum);
+        double rowMajor = benchmarkTraversal(region, maxComponentSumRowMajor, &rowChecksum);
+
+        if (columnChecksum != rowChecksum) {
+            printf("Traversals disagree on %s\n", sizes[i].name);
+            return -1;
+        }
+
+        printf("%-8s %-14s %12.2f %12.2f\n", sizes[i].name, "column-major", columnMajor, frameBytes / (columnMajor * 1.0e6));
+        printf("%-8s %-14s %12.2f %12.2f\n", sizes[i].name, "row-major", rowMajor, frameBytes / (rowMajor * 1.0e6));
+    }
+
+    printf("\n%-8s %-14s %-8s %12s %12s\n", "frame", "kernel", "pixels", "ms/frame", "GB/s");
+    
+    const float * kernelLookupTable = sharedPQLookupTable(PQ_FULL_BLACK, PQ_FULL_WHITE);
+    HDRKernelISA isas[] = {HDRKernelScalar, HDRKernelSSE41, HDRKernelAVX2};
+    HDRLightLevelAccumulator * accumulator = new HDRLightLevelAccumulator;
+    
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        
+        std::vector<uint16_t> noisyPixels = syntheticFrame(sizes[i].width, sizes[i].height);
+        std::vector<uint16_t> flatPixels(noisyPixels.size(), BENCHMARK_FLAT_CODE);
+        double frameBytes = (double)noisyPixels.size() * sizeof(uint16_t);
+        
+        for (int flat = 0; flat < 2; flat++) {
+            
+            HDRPixelRegion region = pixelRegionForFrame(flat ? flatPixels.data() : noisyPixels.data(), sizes[i].width, BENCHMARK_CHANNELS, 0, 0, sizes[i].width, sizes[i].height);
+            double referenceSum = -1.0;
+            
+            for (size_t isa = 0; isa < sizeof(isas) / sizeof(isas[0]); isa++) {
+                
+                HDRLightLevelRowFunction reduceRow = lightLevelRowFunctionForISA(isas[isa], HDRColorSpaceBT2020, false);
+                if (!reduceRow) {
+                    continue;
+                }
+                
+                double elapsed = benchmarkKernel(region, reduceRow, kernelLookupTable, accumulator);
+                
+                double sum = lightLevelMaxComponentSum(accumulator);
+                if (referenceSum >= 0.0 && sum != referenceSum) {
+                    printf("Kernels disagree on %s\n", sizes[i].name);
+                    return -1;
+                }
+                referenceSum = sum;
+                
+                printf("%-8s %-14s %-8s %12.2f %12.2f\n", sizes[i].name, lightLevelKernelName(isas[isa]), flat ? "flat" : "noisy", elapsed, frameBytes / (elapsed * 1.0e6));
+            }
+        }
+    }
+    
+    delete accumulator;
+    
+    std::vector<float> lookupTable(PQ_LOOKUP_TABLE_SIZE);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    buildPQLookupTable(PQ_LEGAL_BLACK, PQ_LEGAL_WHITE, lookupTable.data());
+    double perFrameBuild = millisecondsSince(start);
+
+    //The first call builds the table, every later frame only looks it up
+    start = std::chrono::steady_clock::now();
+    const float * sharedLookupTable = NULL;
+    for (int frame = 0; frame < BENCHMARK_LOOKUP_FRAMES; frame++) {
+        sharedLookupTable = sharedPQLookupTable(PQ_LEGAL_BLACK, PQ_LEGAL_WHITE);
+    }
+    double sharedPerFrame = millisecondsSince(start) / BENCHMARK_LOOKUP_FRAMES;
+
+    if (sharedLookupTable[PQ_LEGAL_WHITE] != lookupTable[PQ_LEGAL_WHITE]) {
+        printf("Shared lookup table differs from the per frame table\n");
+        return -1;
+    }
+
+    printf("\n%-30s %12s\n", "lookup table setup", "ms/frame");
+    printf("%-30s %12.4f\n", "built per frame", perFrameBuild);
+    printf("%-30s %12.4f\n", "shared, over 1000 frames", sharedPerFrame);
+
+    return 0;
+}
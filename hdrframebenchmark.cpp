@@ -0,0 +1,423 @@
+//
+//  hdrframebenchmark.cpp
+//  HDR GENERATOR TOOL
+//
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+
+#include "activedimensions.h"
+#include "framemetadata.h"
+#include "framescheduler.h"
+#include "luminancekernel.h"
+#include "pqlookup.h"
+#include "scanlinestrips.h"
+#include "syntheticframes.h"
+#include "tiffmapping.h"
+
+/*
+
+ HDR FRAME BENCHMARK
+ Times every stage of measuring a frame on synthetic 16-bit RGB TIFFs written to a scratch folder:
+ building the lookup table, decoding, the light level kernel on each ISA the CPU supports, finding the
+ active area and the whole per frame path at several thread counts. Frames are generated from fixed
+ seeds, so runs on different machines or builds measure the same pixels.
+
+ Each stage also checks its results: the kernel ISAs must agree bit for bit, the active area found must
+ be the one the frame was generated with, and every thread count must measure the same values as one
+ thread, whether the frames are mapped in place or read through OpenImageIO. The exit status is
+ non-zero if any check fails.
+
+ hdrframebenchmark <scratch folder> [--frames n] [--sizes 2K,4K,8K] [--threads 1,2,4] [--json file] [--keep]
+
+ With --json every measurement is also written as one object in a flat array, for comparing runs.
+ The decode and end to end numbers include the file system, so use local storage and run twice if
+ the first run should not count the page cache being filled.
+ */
+
+#define BENCHMARK_DEFAULT_FRAMES 4
+#define BENCHMARK_DEFAULT_SIZES "2K,4K"
+#define BENCHMARK_KERNEL_PASSES 3
+#define BENCHMARK_LOOKUP_BUILDS 20
+
+typedef struct {
+    const char * name;
+    int width;
+    int height;
+} HDRBenchmarkFrameSize;
+
+typedef struct {
+    std::string frameCase;
+    std::string size;
+    std::string stage;
+    std::string variant;
+    double value;
+    const char * unit;
+} HDRBenchmarkMeasurement;
+
+static const HDRBenchmarkFrameSize frameSizes[] = {
+    {"2K", 2048, 1080},
+    {"4K", 4096, 2160},
+    {"8K", 8192, 4320}
+};
+
+static std::vector<HDRBenchmarkMeasurement> measurements;
+static int failedChecks = 0;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void record(const std::string & frameCase, const std::string & size, const char * stage, const std::string & variant, double value, const char * unit){
+    
+    HDRBenchmarkMeasurement measurement = {frameCase, size, stage, variant, value, unit};
+    measurements.push_back(measurement);
+    
+    printf("%-10s %-4s %-10s %-12s %12.3f %s\n", frameCase.c_str(), size.c_str(), stage, variant.c_str(), value, unit);
+}
+
+static void failCheck(const std::string & frameCase, const std::string & size, const char * what){
+    printf("CHECK FAILED: %s %s %s\n", frameCase.c_str(), size.c_str(), what);
+    failedChecks++;
+}
+
+static std::vector<std::string> splitList(const char * list){
+    std::vector<std::string> items;
+    std::string item;
+    for (const char * c = list; ; c++) {
+        if (*c == ',' || *c == '\0') {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+            item.clear();
+            if (*c == '\0') {
+                break;
+            }
+        } else {
+            item += *c;
+        }
+    }
+    return items;
+}
+
+static bool sameResult(const HDRMetaDataResult & a, const HDRMetaDataResult & b){
+    return a.maxFALL == b.maxFALL && a.maxCLL == b.maxCLL && a.maxPixelCLL == b.maxPixelCLL &&
+           a.activeY == b.activeY && a.activeHeight == b.activeHeight;
+}
+
+static bool writeMeasurementsAsJSON(const char * path){
+    
+    FILE * file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    
+    //Every string written is a fixed name or one built from them, none needs escaping
+    fprintf(file, "[\n");
+    for (size_t i = 0; i < measurements.size(); i++) {
+        const HDRBenchmarkMeasurement & m = measurements[i];
+        fprintf(file, "  {\"case\": \"%s\", \"size\": \"%s\", \"stage\": \"%s\", \"variant\": \"%s\", \"value\": %.6f, \"unit\": \"%s\"}%s\n",
+                m.frameCase.c_str(), m.size.c_str(), m.stage.c_str(), m.variant.c_str(), m.value, m.unit, i + 1 < measurements.size() ? "," : "");
+    }
+    fprintf(file, "]\n");
+    
+    return fclose(file) == 0;
+}
+
+static void benchmarkLookupTable(){
+    
+    std::vector<float> lookupTable(PQ_LOOKUP_TABLE_SIZE);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCHMARK_LOOKUP_BUILDS; i++) {
+        buildPQLookupTable(PQ_LEGAL_BLACK, PQ_LEGAL_WHITE, lookupTable.data());
+    }
+    record("-", "-", "lut", "build", millisecondsSince(start) / BENCHMARK_LOOKUP_BUILDS, "ms");
+    
+    start = std::chrono::steady_clock::now();
+    HDRLightLevelKernel kernel = selectLightLevelKernel(HDRColorSpaceBT2020, HDRSignalRangeLegal, false);
+    record("-", "-", "lut", "select", millisecondsSince(start), "ms");
+    
+    if (kernel.lookupTable[PQ_LEGAL_WHITE] != lookupTable[PQ_LEGAL_WHITE]) {
+        failCheck("-", "-", "shared lookup table differs from a built one");
+    }
+}
+
+//ISAs spread the max code counts over the histogram copies differently, only their sum has to match
+static void mergeMaxCodeHistogramCopies(HDRLightLevelAccumulator * accumulator){
+    for (int copy = 1; copy < HDR_KERNEL_HISTOGRAM_COPIES; copy++) {
+        for (int bin = 0; bin < HDR_KERNEL_HISTOGRAM_BINS; bin++) {
+            accumulator->maxCodeHistogram[0][bin] += accumulator->maxCodeHistogram[copy][bin];
+            accumulator->maxCodeHistogram[copy][bin] = 0;
+        }
+    }
+}
+
+//Every ISA reduces the same frame in memory; the accumulators have to match byte for byte
+static void benchmarkKernels(HDRSyntheticFrameKind kind, const HDRBenchmarkFrameSize & size){
+    
+    const char * kindName = syntheticFrameKindName(kind);
+    std::vector<uint16_t> pixels((size_t)size.width * size.height * SCANLINE_STRIP_CHANNELS);
+    fillSyntheticFrame(kind, size.width, size.height, 1, pixels.data());
+    double frameBytes = (double)pixels.size() * sizeof(uint16_t);
+    
+    const float * lookupTable = sharedPQLookupTable(PQ_FULL_BLACK, PQ_FULL_WHITE);
+    HDRLightLevelAccumulator reference;
+    bool haveReference = false;
+    
+    HDRKernelISA isas[] = {HDRKernelScalar, HDRKernelSSE41, HDRKernelAVX2};
+    
+    for (size_t i = 0; i < sizeof(isas) / sizeof(isas[0]); i++) {
+        
+        HDRLightLevelRowFunction reduceRow = lightLevelRowFunctionForISA(isas[i], HDRColorSpaceBT2020, false);
+        if (!reduceRow) {
+            continue;
+        }
+        
+        HDRLightLevelAccumulator accumulator;
+        double best = 0.0;
+        
+        for (int pass = 0; pass < BENCHMARK_KERNEL_PASSES; pass++) {
+            resetLightLevelAccumulator(&accumulator);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (int y = 0; y < size.height; y++) {
+                reduceRow(pixels.data() + ((size_t)y * size.width * SCANLINE_STRIP_CHANNELS), size.width, lookupTable, &accumulator);
+            }
+            double elapsed = millisecondsSince(start);
+            if (pass == 0 || elapsed < best) {
+                best = elapsed;
+            }
+        }
+        
+        record(kindName, size.name, "kernel", lightLevelKernelName(isas[i]), frameBytes / (best * 1.0e6), "GB/s");
+        
+        mergeMaxCodeHistogramCopies(&accumulator);
+        if (!haveReference) {
+            reference = accumulator;
+            haveReference = true;
+        } else if (memcmp(&reference, &accumulator, sizeof(accumulator)) != 0) {
+            failCheck(kindName, size.name, "kernel ISAs disagree");
+        }
+    }
+}
+
+static std::string framePath(const std::string & folder, HDRSyntheticFrameKind kind, const HDRBenchmarkFrameSize & size, int frame){
+    char name[128];
+    snprintf(name, sizeof(name), "/%s_%s_%04d.tif", size.name, syntheticFrameKindName(kind), frame);
+    return folder + name;
+}
+
+static void benchmarkFiles(HDRSyntheticFrameKind kind, const HDRBenchmarkFrameSize & size, const std::vector<std::string> & paths, const std::vector<int> & threadCounts){
+    
+    const char * kindName = syntheticFrameKindName(kind);
+    double frameBytes = (double)size.width * size.height * SCANLINE_STRIP_CHANNELS * sizeof(uint16_t);
+    int frameCount = (int)paths.size();
+    
+    //Decode: whole frames, as read_scanlines hands them to the generator
+    std::vector<uint16_t> pixels((size_t)size.width * size.height * SCANLINE_STRIP_CHANNELS);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frameCount; i++) {
+        OIIO::ImageInput * in = OIIO::ImageInput::open(paths[i]);
+        if (!in || !in->read_scanlines(0, size.height, 0, 0, SCANLINE_STRIP_CHANNELS, OIIO::TypeDesc::UINT16, pixels.data())) {
+            failCheck(kindName, size.name, "frame could not be decoded");
+        }
+        if (in) {
+            in->close();
+            closeImageInput(in);
+        }
+    }
+    double decode = millisecondsSince(start) / frameCount;
+    record(kindName, size.name, "decode", "oiio", decode, "ms/frame");
+    record(kindName, size.name, "decode", "oiio", frameBytes / (decode * 1.0e3), "MB/s");
+    
+    //Active area probe
+    std::pair<int, int> expected = syntheticFrameActiveRows(kind, size.width, size.height);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frameCount; i++) {
+        if (getActiveAreaDimensionsForFilePath(paths[i].c_str()) != expected) {
+            failCheck(kindName, size.name, "active area differs from the generated one");
+        }
+    }
+    record(kindName, size.name, "probe", "strips", millisecondsSince(start) / frameCount, "ms/frame");
+    
+    //End to end, as the generator runs without -y/-d: every frame finds and measures its own rows
+    HDRLightLevelKernel kernel = selectLightLevelKernel(HDRColorSpaceBT2020, HDRSignalRangeFull, false);
+    HDRActiveArea wholeFrame = {0, 0, 0, 0};
+    std::vector<HDRMetaDataResult> reference;
+    
+    //Mapped in place first, then through OpenImageIO as the fallback reads them
+    for (int reader = 0; reader < 2; reader++) {
+        
+        setMappedTiffReadsEnabled(reader == 0);
+        
+        for (size_t t = 0; t < threadCounts.size(); t++) {
+            
+            std::vector<HDRMetaDataResult> results;
+            int nextFrame = 0;
+            
+            auto nextJob = [&](int & frame){
+                if (nextFrame >= frameCount) {
+                    return false;
+                }
+                frame = nextFrame++;
+                return true;
+            };
+            auto compute = [&](int frame){
+                return calculateMetadataForPath(paths[frame].c_str(), kernel, wholeFrame, false, false);
+            };
+            auto emit = [&](int, const HDRMetaDataResult & result){
+                results.push_back(result);
+            };
+            
+            start = std::chrono::steady_clock::now();
+            processFramesInOrder<int, HDRMetaDataResult>(threadCounts[t], threadCounts[t] * 4, nextJob, compute, emit);
+            double elapsed = millisecondsSince(start);
+            
+            char variant[32];
+            snprintf(variant, sizeof(variant), "%d threads %s", threadCounts[t], reader == 0 ? "mapped" : "oiio");
+            record(kindName, size.name, "frame", variant, frameCount / (elapsed / 1000.0), "frames/s");
+            
+            if (reference.empty()) {
+                reference = results;
+                continue;
+            }
+            
+            for (int i = 0; i < frameCount; i++) {
+                if (!sameResult(reference[i], results[i])) {
+                    failCheck(kindName, size.name, "results differ between thread counts or readers");
+                    break;
+                }
+            }
+        }
+    }
+    
+    setMappedTiffReadsEnabled(true);
+}
+
+int main(int argc, const char * argv[]) {
+    
+    if (argc < 2) {
+        printf("Usage: hdrframebenchmark <scratch folder> [--frames n] [--sizes 2K,4K,8K] [--threads 1,2,4] [--json file] [--keep]\n");
+        return -1;
+    }
+    
+    std::string folder = argv[1];
+    int frameCount = BENCHMARK_DEFAULT_FRAMES;
+    std::vector<std::string> sizeNames = splitList(BENCHMARK_DEFAULT_SIZES);
+    std::vector<int> threadCounts;
+    const char * jsonPath = NULL;
+    bool keepFrames = false;
+    
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frameCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            sizeNames = splitList(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            std::vector<std::string> counts = splitList(argv[++i]);
+            for (size_t c = 0; c < counts.size(); c++) {
+                threadCounts.push_back(atoi(counts[c].c_str()));
+            }
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keepFrames = true;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    
+    if (frameCount < 1) {
+        printf("--frames must be at least 1\n");
+        return -1;
+    }
+    
+    for (size_t t = 0; t < threadCounts.size(); t++) {
+        if (threadCounts[t] < 1) {
+            printf("--threads values must be at least 1\n");
+            return -1;
+        }
+    }
+    
+    //1, 2, 4... up to the number of cores
+    if (threadCounts.empty()) {
+        int cores = (int)std::thread::hardware_concurrency();
+        for (int threads = 1; threads < cores; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(cores > 1 ? cores : 1);
+    }
+    
+    std::vector<HDRBenchmarkFrameSize> sizes;
+    for (size_t i = 0; i < sizeNames.size(); i++) {
+        size_t s = 0;
+        while (s < sizeof(frameSizes) / sizeof(frameSizes[0]) && sizeNames[i] != frameSizes[s].name) {
+            s++;
+        }
+        if (s == sizeof(frameSizes) / sizeof(frameSizes[0])) {
+            printf("Unknown frame size %s, use 2K, 4K or 8K\n", sizeNames[i].c_str());
+            return -1;
+        }
+        sizes.push_back(frameSizes[s]);
+    }
+    
+    if (mkdir(folder.c_str(), 0755) != 0 && access(folder.c_str(), W_OK) != 0) {
+        printf("Can't write to %s\n", folder.c_str());
+        return -1;
+    }
+    
+    printf("Kernel: %s, %d frames per case\n\n", lightLevelKernelName(selectedLightLevelKernelISA()), frameCount);
+    printf("%-10s %-4s %-10s %-12s %12s %s\n", "case", "size", "stage", "variant", "value", "unit");
+    
+    benchmarkLookupTable();
+    
+    for (size_t s = 0; s < sizes.size(); s++) {
+        for (int k = 0; k < HDRSyntheticFrameKindCount; k++) {
+            
+            HDRSyntheticFrameKind kind = (HDRSyntheticFrameKind)k;
+            
+            benchmarkKernels(kind, sizes[s]);
+            
+            std::vector<std::string> paths;
+            for (int frame = 0; frame < frameCount; frame++) {
+                paths.push_back(framePath(folder, kind, sizes[s], frame));
+                if (!writeSyntheticFrame(paths.back().c_str(), kind, sizes[s].width, sizes[s].height, (uint32_t)frame + 1)) {
+                    printf("Can't write %s\n", paths.back().c_str());
+                    return -1;
+                }
+            }
+            
+            benchmarkFiles(kind, sizes[s], paths, threadCounts);
+            
+            if (!keepFrames) {
+                for (size_t i = 0; i < paths.size(); i++) {
+                    unlink(paths[i].c_str());
+                }
+            }
+        }
+    }
+    
+    if (jsonPath && !writeMeasurementsAsJSON(jsonPath)) {
+        printf("Can't write %s\n", jsonPath);
+        return -1;
+    }
+    
+    if (failedChecks > 0) {
+        printf("\n%d checks failed\n", failedChecks);
+        return 1;
+    }
+    
+    return 0;
+}
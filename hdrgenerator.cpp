@@ -9,37 +9,45 @@
 
 
 #include <iostream>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <map>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QCommandLineParser>
 #include <QtCore/QString>
 #include <QtCore/QStringList>
 #include <QtCore/QFileInfo>
-#include <QtCore/QDirIterator>
 #include <QtCore/QFile>
 #include <QtCore/QTextStream>
 #include <QtCore/QDir>
 #include <QtCore/QDebug>
 #include <QtCore/QDateTime>
-#include <QtConcurrent/QtConcurrent>
 
 #include <OpenImageIO/imageio.h>
 
-#ifdef __APPLE__
-#include <Opencv2/core/core.hpp>
-// FOR TESTING ONLY
-#include <Opencv2/highgui/highgui.hpp>
-#include <Opencv2/imgproc/imgproc.hpp>
-#else
-#include <opencv2/core/core.hpp>
-// FOR TESTING ONLY
-#include <opencv2/highgui/highgui.hpp>
-#include <opencv2/imgproc/imgproc.hpp>
-#endif
-
 #include "activedimensions.h"
+#include "framemetadata.h"
+#include "luminancekernel.h"
+#include "pixelrows.h"
+#include "pqlookup.h"
+#include "scanlinestrips.h"
+#include "framescheduler.h"
+#include "bufferarena.h"
+#include "lightlevelstats.h"
+#include "luminancehistogram.h"
+#include "adaptivearea.h"
+#include "resultjournal.h"
+#include "fileidentity.h"
+#include "resultcache.h"
+#include "directoryscan.h"
+#include "folderwatch.h"
+#include "previewsampling.h"
+#include "runmetrics.h"
+#include "tiffmapping.h"
+#include "scenelinear.h"
 
 OIIO_NAMESPACE_USING
-using namespace cv;
 
 
 /*
@@ -47,46 +55,20 @@ using namespace cv;
  HDR GENERATOR TOOL
  In its essence, this tool will calculate the maxFall and maxCLL of a 16-bit TIFF frame using the formula 'PQ10000_f' (defined by Bill Mandel). This application will scan a folder of
  TIFF files and proceed to perform calculations on the files. File results are calculated concurrently according to the number of threads a user specifies. The
- results will be logged to a file as will the files processed and the time the files were processed. OpenImageIO is used to read the files into a 16bit vector.
- OpenCV is used for conveniently accessing pixels as well as cropoing an image for frame average light level calculations. QtCore and QtConcurrent are used for 
- abstracted file system access and concurrency respectively. The text files generated in this process are then analyzed in a post process tool to calculate 
- maxFall and maxCLL values at 99.9%.
+ results will be logged to a file as will the files processed and the time the files were processed. OpenImageIO is used to read the active rows of the files
+ into 16bit buffers, which the light level kernels walk row by row (pixelrows.h). QtCore is used for abstracted file
+ system access and a persistent pool of worker threads (framescheduler.h) processes the frames. As results are written the reel level maxFall and maxCLL, and their values at
+ 99.9% of frames, are gathered in constant memory (lightlevelstats.h) and printed at the end of the run.
  */
 
-double PQ10000_f( double V){
-    //  10000 nits
-    //  1/gamma-ish, calculate V from Luma
-    //  decode L = (max(,0)/(c2-c3*V**(1/m)))**(1/n)
-    //  Lw, Lb not used since absolute Luma used for PQ
-    //  formula outputs normalized Luma from 0-1
-    
-    double L = 0.0;
-    L = pow(max(pow(V, 1.0/78.84375) - 0.8359375 ,0.0)/(18.8515625 - 18.6875 * pow(V, 1.0/78.84375)),1.0/0.1593017578);
-    return L;
-}
-
-Mat resizedMat(Mat input, double scale){
-    Mat resizedImage;
-    resize(input, resizedImage, cv::Size(), scale, scale, CV_INTER_LINEAR);//CV_INTER_LINEAR CV_INTER_CUBIC
-    return resizedImage;
-}
+#define REEL_PERCENTILE 0.999
 
+//Last measured light levels of a frame, kept per path in watch mode where a frame can land again
 typedef struct {
     double maxFALL;
     double maxCLL;
-} HDRMetaDataResult;
-
-typedef QPair<QString, HDRMetaDataResult> HDRFileResultPair;
-
-#define CANT_OPEN_FILE {-1., -1.}
-#define INVALID_ACTIVE_AREA {-2., -2.}
-
-typedef struct {
-    int x;      //These are ignored for now
-    int y;
-    int width;  //These are ignored for now
-    int height;
-} HDRActiveArea;
+    double maxPixelCLL;
+} HDRFrameLightLevels;
 
 typedef struct {
     int y;
@@ -96,130 +78,139 @@ typedef struct {
 
 typedef struct {
     QString filePath;
-    bool use2020;
-    bool useFull;
+    HDRLightLevelKernel kernel;
     HDRActiveArea activeArea;
+    bool adaptiveArea;                          //Find the active rows of every frame as it is reduced, activeArea is then the whole frame
+    bool preview;                               //Estimate from a sample of the strips of activeArea, see previewsampling.h
+    const HDRMetaDataResult * probeResult;     //Set when the active area probe already measured this file over activeArea
+    const HDRResultRecord * resumeRecord;      //Set when an earlier run journaled this path, used if the file hasn't changed since
+    const HDRResultCache * cache;              //Looked up before measuring when set
+    HDRResultCacheParameters cacheParameters;
+    bool verifyCache;                          //Key the cache on the file's contents rather than its identity
+    bool watched;                              //Landed after the run started, see --watch
 } HDRUserData;
 
-HDRMetaDataResult calculateMetadataForPath(const char * path, bool use2020, bool useFull, HDRActiveArea area){
+static HDRMetaDataResult storedMetadataResult(double maxFALL, double maxCLL, double maxPixelCLL, int activeY, int activeHeight, const HDRFileIdentity & identity){
     
-    ImageInput *in = ImageInput::open (path);
-    if (!in){
-        return CANT_OPEN_FILE;
-    }
+    HDRMetaDataResult result;
+    memset(&result, 0, sizeof(result));
+    result.maxFALL = maxFALL;
+    result.maxCLL = maxCLL;
+    result.maxPixelCLL = maxPixelCLL;
+    result.activeY = activeY;
+    result.activeHeight = activeHeight;
+    result.fileIdentity = identity;
+    
+    return result;
+}
+
+/*
+ A result measured before, either journaled by an earlier run for the same unchanged file or found
+ in the result cache. On a miss cacheKey is left as the key a measured result should be cached under,
+ 0 without a cache.
+ */
+static bool storedResultForUserData(const HDRUserData & data, HDRMetaDataResult & result, uint64_t & cacheKey){
     
-    const ImageSpec &spec = in->spec();
-    int xres = spec.width;
-    int yres = spec.height;
-    int channels = spec.nchannels;
-    std::vector<uint16_t> pixels (xres*yres*channels*sizeof(uint16_t));
+    cacheKey = 0;
     
-    if ((area.height + area.y) > yres) {
-        return INVALID_ACTIVE_AREA;
+    if (!data.resumeRecord && !data.cache) {
+        return false;
     }
     
-    if (area.height == 0) { area.height = yres;}
-    if (area.width == 0) {  area.width = xres;}
+    QByteArray array = data.filePath.toLocal8Bit();
+    const char * path = (const char *)array.data();
     
-    //printf("opening file for reading...\n");
-    in->read_image (TypeDesc::UINT16, &pixels[0]);
-    //printf("finished reading...\n");
+    HDRFileIdentity identity;
+    if (!fileIdentityForPath(path, &identity)) {
+        return false;
+    }
     
-    //printf("creating opencv mat...\n");
-    Mat mainImage = Mat(yres, xres, CV_16UC3, pixels.data());
+    const HDRResultRecord * record = data.resumeRecord;
+    if (record && sameFileIdentity(identity, record->identity)) {
+        result = storedMetadataResult(record->maxFALL, record->maxCLL, record->maxPixelCLL, record->activeY, record->activeHeight, identity);
+        result.resumed = true;
+        return true;
+    }
     
-    //printf("creating sub mat\n");
-    yres = area.height;
-    Mat cvImage = mainImage(Rect(0, area.y, xres, yres ));
+    if (!data.cache) {
+        return false;
+    }
     
-    //    cv::imshow("Histogram", resizedMat(cvImage, 0.2) );
-    //    cv::waitKey(0);
+    uint64_t contentHash = 0;
+    if (data.verifyCache && !hashFileContents(path, &contentHash)) {
+        return false;
+    }
     
-    float black = 4096.0;
-    float range = 60160.0 - black;
+    cacheKey = resultCacheKey(identity, contentHash, data.cacheParameters);
     
-    if (useFull == true) {
-        black = 0;
-        range = 65535.0;
+    const HDRResultCacheRecord * cached = data.cache->find(cacheKey);
+    if (!cached) {
+        return false;
     }
     
-    //Create lookup table
-    float * lookupTable = (float*)calloc(2 << 16, sizeof(float));
-    int pixelMax = 2 << 15;
-    for (int i = 0; i < pixelMax; i++) {
-        float result = PQ10000_f((float)(i - black) / range);
-        *(lookupTable+i) = result;
-    }
+    result = storedMetadataResult(cached->maxFALL, cached->maxCLL, cached->maxPixelCLL, cached->activeY, cached->activeHeight, identity);
+    result.maxFALLStandardError = cached->maxFALLStandardError;
+    result.cached = true;
+    result.cacheKey = cacheKey;
     
-    double mean = 0;
-    double maxFALL = 0;
-    double maxCLL = 0;
-    float LMAX = 0.0;
-    double L = 0.0;
+    return true;
+}
+
+static HDRMetaDataResult calculateMetadataForUserData(const HDRUserData & data){
     
-    for (int x = 0; x < xres; x++) {
-        for (int y = 0; y < yres; y++) {
-            
-            Vec3w currentPixel = cvImage.at<Vec3w>(y,x);
-            
-            float red = *(lookupTable+currentPixel.val[0]);
-            float green = *(lookupTable+currentPixel.val[1]);
-            float blue = *(lookupTable+currentPixel.val[2]);
-            
-            LMAX = fmax(red, green);
-            LMAX = fmax(LMAX, blue);
-            
-            if(use2020) {
-                L = (0.2627 * red) + (0.6780 * green) + (0.0593 * blue);
-            } else {
-                // P3D65:
-                L = (0.228975 * red) + (0.691739 * green) + (0.0792869 * blue);
-            }
-            
-            mean += L;
-            maxFALL += LMAX;
-            
-            if(LMAX > maxCLL){
-                maxCLL = LMAX;
-            }
-            
-            
-        }
-        
+    HDRMetaDataResult result;
+    uint64_t cacheKey;
+    if (storedResultForUserData(data, result, cacheKey)) {
+        return result;
     }
     
-    HDRMetaDataResult result = {10000.0 * (maxFALL/(xres*yres)), 10000.0 * maxCLL};
-    
-#ifdef __APPLE__
-    ImageInput::destroy (in);
-#else
-    delete in;
-#endif
+    //Measured by the probe, but still cached like a frame measured here
+    if (data.probeResult) {
+        result = *data.probeResult;
+        result.cacheKey = cacheKey;
+        return result;
+    }
     
-    free(lookupTable);
+    QByteArray array = data.filePath.toLocal8Bit();
+    result = calculateMetadataForPath((const char *)array.data(), data.kernel, data.activeArea, data.adaptiveArea, data.preview);
+    result.cacheKey = cacheKey;
     
     return result;
-    
 }
 
-static HDRFileResultPair calculateMetadataForPathConcurrently(HDRUserData data){
+static void loadActiveAreaForUserData(const HDRUserData & data, HDRFrameBuffer & frame){
+    
+    //An unloaded frame hands its status on as the result
+    if (storedResultForUserData(data, frame.status, frame.cacheKey)) {
+        frame.loaded = false;
+        return;
+    }
+    
+    if (data.probeResult) {
+        frame.status = *data.probeResult;
+        frame.loaded = false;
+        return;
+    }
     
     QByteArray array = data.filePath.toLocal8Bit();
-    char * path = array.data();
-    bool use2020 = data.use2020;
-    bool useFull = data.useFull;
-    HDRActiveArea activeArea = data.activeArea;
+    loadActiveAreaForPath((const char *)array.data(), data.activeArea, data.kernel.sceneLinear, frame);
+}
+
+static HDRMetaDataResult calculateMetadataForUserDataFrame(const HDRUserData & data, HDRFrameBuffer & frame){
     
-    HDRMetaDataResult result = calculateMetadataForPath((const char *)path, use2020, useFull, activeArea);
-    return qMakePair(data.filePath, result);
+    HDRMetaDataResult result = calculateMetadataForFrameBuffer(frame, data.kernel, data.adaptiveArea);
+    result.cacheKey = frame.cacheKey;
+    
+    return result;
 }
 
-static bool sortHDRUserDataFilePath(const HDRFileResultPair v1, const HDRFileResultPair v2){
-    int result =  QString::compare(v1.first, v2.first);
-    if (result == 1) {
-        return false;
+//Ends watch mode on SIGINT or SIGTERM, the frames in flight are still written and the run summed up
+static HDRFolderWatcher * runningFolderWatcher = NULL;
+
+static void stopWatchingOnSignal(int){
+    if (runningFolderWatcher) {
+        runningFolderWatcher->stop();
     }
-    return true;
 }
 
 int getRandomNumber(const int Min, const int Max){
@@ -239,19 +230,16 @@ QString currentDateString(){
     return QString(QDateTime::currentDateTime().toString("_MMddyy_hhmm"));
 }
 
+//Every frame under path in natural name order, see directoryscan.h
 QStringList getListOfTiffFilesFromPath(QString path){
     QStringList tiffFiles;
     
-    QDirIterator it(path, QDirIterator::Subdirectories);
-    while (it.hasNext()) {
-        QString next = it.next();
-        if(next.endsWith("tiff", Qt::CaseInsensitive) == true ||
-            next.endsWith("tif", Qt::CaseInsensitive) == true){
-            tiffFiles.append(next);
-        }
+    HDRDirectoryScanner scanner(std::string(path.toLocal8Bit().data()), DIRECTORY_SCAN_THREADS);
+    std::string next;
+    while (scanner.next(next)) {
+        tiffFiles.append(QString::fromLocal8Bit(next.c_str()));
     }
     
-    tiffFiles.sort(Qt::CaseInsensitive);
     return tiffFiles;
 }
 
@@ -278,6 +266,24 @@ QStringList getListOfFilesFromFileStream(QString path){
     return list;
 }
 
+//The paths of the valid records of a binary result journal, empty if path isn't one
+QStringList getListOfFilesFromResultJournal(QString path){
+    
+    QStringList list;
+    HDRResultJournalView view;
+    
+    if (mapResultJournal(&view, path.toLocal8Bit().data())) {
+        for (size_t i = 0; i < view.recordCount; i++) {
+            if (resultJournalRecordIsValid(&view, i)) {
+                list << QString::fromLocal8Bit(resultJournalRecordPath(&view, i), view.records[i].pathLength);
+            }
+        }
+        unmapResultJournal(&view);
+    }
+    
+    return list;
+}
+
 typedef QMap<QString, QString> FilePathMap;
 
 FilePathMap getMapOfFilesFromFilePath(QString path){
@@ -344,7 +350,97 @@ FilePathMap getMapOfFilesFromList(QStringList list){
     return filePathMap;
 }
 
+//Static metadata is reported in whole cd/m2, rounded up
+static void printLightLevelStatistics(const HDRLightLevelStatistics * statistics){
+    std::cout << "Light levels of " << statistics->frameCount << " frames (" << statistics->failedFrameCount << " failed):" << std::endl;
+    std::cout << "\t" << "MaxFALL" << " " << ceil(statistics->maxFALL) << " (99.9% of frames: " << ceil(lightLevelStatisticsFALLPercentile(statistics, REEL_PERCENTILE)) << ")" << std::endl;
+    std::cout << "\t" << "MaxCLL" << " " << ceil(statistics->maxCLL) << " (99.9% of frames: " << ceil(lightLevelStatisticsCLLPercentile(statistics, REEL_PERCENTILE)) << ")" << std::endl;
+    std::cout << "\t" << "MaxCLL of 99.9% of pixels" << " " << ceil(statistics->maxPixelCLL) << std::endl;
+}
+
+//Where the time went, so a slow run shows whether storage, decoding or the kernel held it up
+static void printRunMetrics(const HDRRunMetricsSnapshot & snapshot){
+    
+    std::cout << "Measured " << snapshot.framesMeasured << " of " << snapshot.framesWritten << " frames in " << snapshot.elapsedSeconds << " s: "
+              << (snapshot.elapsedSeconds > 0.0 ? snapshot.framesWritten / snapshot.elapsedSeconds : 0.0) << " frames/s, "
+              << (snapshot.elapsedSeconds > 0.0 ? snapshot.bytesRead / (snapshot.elapsedSeconds * 1.0e6) : 0.0) << " MB/s" << std::endl;
+    
+    for (int i = 0; i < HDRRunStageCount; i++) {
+        const HDRStageLatency & latency = snapshot.stages[i];
+        if (latency.count == 0) {
+            continue;
+        }
+        std::cout << "\t" << runStageName((HDRRunStage)i) << " ms per frame: mean " << latency.totalNanoseconds / (latency.count * 1.0e6)
+                  << ", p50 " << stageLatencyPercentile(&latency, 0.5) << ", p99 " << stageLatencyPercentile(&latency, 0.99)
+                  << ", max " << latency.maxNanoseconds / 1.0e6 << std::endl;
+    }
+}
+
+//hdrgenerator merge <statistics file>...: the reel light levels of shards measured separately, as one run over all of their frames would report them
+static int mergeLightLevelStatisticsFiles(int count, const char * paths[]){
+    
+    if (count <= 0) {
+        std::cout << "Usage: hdrgenerator merge <statistics file>..." << std::endl;
+        return -1;
+    }
+    
+    HDRLightLevelStatistics * statistics = new HDRLightLevelStatistics;
+    HDRLightLevelStatistics * shard = new HDRLightLevelStatistics;
+    resetLightLevelStatistics(statistics);
+    
+    std::map<int, int> shardsSeen;
+    int shardCount = 0;
+    bool complete = true;
+    
+    for (int i = 0; i < count; i++) {
+        
+        int shardIndex;
+        int fileShardCount;
+        if (!readLightLevelStatistics(paths[i], shard, &shardIndex, &fileShardCount)) {
+            std::cout << "Unable to read the statistics file: " << paths[i] << std::endl;
+            complete = false;
+            continue;
+        }
+        
+        if (shardCount == 0) {
+            shardCount = fileShardCount;
+        }
+        
+        if (fileShardCount != shardCount) {
+            std::cout << paths[i] << " is shard " << shardIndex << " of " << fileShardCount << ", not of " << shardCount << std::endl;
+            complete = false;
+            continue;
+        }
+        
+        if (shardsSeen[shardIndex]++ > 0) {
+            std::cout << "Shard " << shardIndex << " is given more than once, skipping " << paths[i] << std::endl;
+            complete = false;
+            continue;
+        }
+        
+        mergeLightLevelStatistics(statistics, shard);
+    }
+    
+    for (int i = 1; i <= shardCount; i++) {
+        if (shardsSeen.find(i) == shardsSeen.end()) {
+            std::cout << "Shard " << i << " of " << shardCount << " is missing" << std::endl;
+            complete = false;
+        }
+    }
+    
+    printLightLevelStatistics(statistics);
+    
+    delete shard;
+    delete statistics;
+    
+    return complete ? 0 : 1;
+}
+
 int main(int argc, const char * argv[]) {
+    
+    if (argc > 1 && strcmp(argv[1], "merge") == 0) {
+        return mergeLightLevelStatisticsFiles(argc - 2, argv + 2);
+    }
 
     // std::cout << currentDateString().toLatin1().data() << std::endl;
     // QString path = "hdr_log" + currentDateString() + ".txt";
@@ -376,6 +472,12 @@ int main(int argc, const char * argv[]) {
     
     parser.addOption(colorOption);
     
+    QCommandLineOption sceneLinearOption(QStringList() << "scene-linear",
+                                         QCoreApplication::translate("main", "Frames hold scene-linear half or float values instead of PQ codes, 1.0 being <nits> cd/m2. The range is ignored."),
+                                         QCoreApplication::translate("main", "nits"));
+    
+    parser.addOption(sceneLinearOption);
+    
     QCommandLineOption yOffsetOption(QStringList() << "y" << "y offset",
                                      QCoreApplication::translate("main", "Specify a y offset."),
                                      QCoreApplication::translate("main", "y offset"));
@@ -416,6 +518,94 @@ int main(int argc, const char * argv[]) {
     
     parser.addOption(threadCountOption);
     
+    QCommandLineOption ioThreadCountOption(QStringList() << "io-threads",
+                                           QCoreApplication::translate("main", "Prefetch frames on this many I/O threads, separately from the compute threads."),
+                                           QCoreApplication::translate("main", "ioThreads"));
+    
+    parser.addOption(ioThreadCountOption);
+    
+    QCommandLineOption computeThreadCountOption(QStringList() << "compute-threads",
+                                                QCoreApplication::translate("main", "Specify the number of compute threads when prefetching (defaults to threadCount)."),
+                                                QCoreApplication::translate("main", "computeThreads"));
+    
+    parser.addOption(computeThreadCountOption);
+    
+    QCommandLineOption hugePagesOption(QStringList() << "huge-pages",
+                                       QCoreApplication::translate("main", "Back the reusable pixel buffers with huge pages where the OS supports it."));
+    
+    parser.addOption(hugePagesOption);
+    
+    QCommandLineOption noMappedReadsOption(QStringList() << "no-mapped-reads",
+                                           QCoreApplication::translate("main", "Read uncompressed TIFFs through OpenImageIO instead of mapping them into memory."));
+    
+    parser.addOption(noMappedReadsOption);
+    
+    QCommandLineOption histogramOption(QStringList() << "histogram",
+                                       QCoreApplication::translate("main", "Write a luminance histogram of every frame to a binary sidecar <histogramFile>."),
+                                       QCoreApplication::translate("main", "histogramFile"));
+    
+    parser.addOption(histogramOption);
+    
+    QCommandLineOption adaptiveAreaOption(QStringList() << "adaptive-area",
+                                          QCoreApplication::translate("main", "Find the letterbox of every frame while it is measured instead of using one active area for the reel."));
+    
+    parser.addOption(adaptiveAreaOption);
+    
+    QCommandLineOption binaryResultsOption(QStringList() << "binary-results",
+                                           QCoreApplication::translate("main", "Also append the results to a binary result journal <journalFile>, which -p accepts too."),
+                                           QCoreApplication::translate("main", "journalFile"));
+    
+    parser.addOption(binaryResultsOption);
+    
+    QCommandLineOption resumeOption(QStringList() << "resume",
+                                    QCoreApplication::translate("main", "Skip files the --binary-results journal already holds a result for, unless they have changed since."));
+    
+    parser.addOption(resumeOption);
+    
+    QCommandLineOption cacheOption(QStringList() << "cache",
+                                   QCoreApplication::translate("main", "Keep frame results in a cache file across runs and only measure frames that aren't in it."),
+                                   QCoreApplication::translate("main", "file"));
+    
+    parser.addOption(cacheOption);
+    
+    QCommandLineOption cacheVerifyOption(QStringList() << "cache-verify",
+                                         QCoreApplication::translate("main", "Identify cached frames by a hash of their contents rather than their size, modification time and inode."));
+    
+    parser.addOption(cacheVerifyOption);
+    
+    QCommandLineOption watchOption(QStringList() << "watch",
+                                   QCoreApplication::translate("main", "After the frames already there, keep measuring frames as they land in the folder until interrupted (Linux only)."));
+    
+    parser.addOption(watchOption);
+    
+    QCommandLineOption previewOption(QStringList() << "preview",
+                                     QCoreApplication::translate("main", "Quickly estimate the light levels from one in 16 strips of each frame, with the standard error of maxFALL as a fifth result column."));
+    
+    parser.addOption(previewOption);
+    
+    QCommandLineOption shardOption(QStringList() << "shard",
+                                   QCoreApplication::translate("main", "Only measure shard i of N equal runs of the sorted frames, counting from 1. Needs --statistics; combine the shards with 'hdrgenerator merge'."),
+                                   QCoreApplication::translate("main", "i/N"));
+    
+    parser.addOption(shardOption);
+    
+    QCommandLineOption statisticsOption(QStringList() << "statistics",
+                                        QCoreApplication::translate("main", "Write the reel statistics to a file that 'hdrgenerator merge' can combine with those of other shards."),
+                                        QCoreApplication::translate("main", "file"));
+    
+    parser.addOption(statisticsOption);
+    
+    QCommandLineOption progressOption(QStringList() << "progress",
+                                      QCoreApplication::translate("main", "Show frames per second, MB/s, queue depths and the time left on stderr while the frames are measured."));
+    
+    parser.addOption(progressOption);
+    
+    QCommandLineOption metricsOption(QStringList() << "metrics",
+                                     QCoreApplication::translate("main", "Write throughput and per stage timings to <file> every few seconds, as Prometheus text if it ends in .prom and as JSON otherwise."),
+                                     QCoreApplication::translate("main", "file"));
+    
+    parser.addOption(metricsOption);
+    
     
     //PROCESS APPLICATION
     parser.process(app);
@@ -455,6 +645,18 @@ int main(int argc, const char * argv[]) {
         use2020 = false;
     }
     
+    //Scene-linear frames are read as half floats and scaled to nits, see scenelinear.h
+    bool sceneLinearFlag = parser.isSet(sceneLinearOption);
+    double sceneLinearNits = 0.0;
+    
+    if (sceneLinearFlag == true) {
+        sceneLinearNits = atof(parser.value(sceneLinearOption).toLatin1().data());
+        if (!(sceneLinearNits > 0.0 && sceneLinearNits <= 10000.0)) {
+            std::cout << "The nits of a scene-linear 1.0 must be greater than 0 and at most 10000, i.e. --scene-linear 100." << std::endl;
+            return -1;
+        }
+    }
+    
     int yOffset = 0;
     int yLength = 0;
 
@@ -530,10 +732,73 @@ int main(int argc, const char * argv[]) {
     }
     
     std::cout << "Starting!" << std::endl;
+    bool statisticsFlag = parser.isSet(statisticsOption);
+    QString statisticsFilePath = statisticsFlag ? QFileInfo(parser.value(statisticsOption)).absoluteFilePath() : QString();
+    bool progressFlag = parser.isSet(progressOption);
+    bool metricsFlag = parser.isSet(metricsOption);
+    QString metricsFilePath = metricsFlag ? QFileInfo(parser.value(metricsOption)).absoluteFilePath() : QString();
+    
+    //Every shard scans the same folder into the same sorted list and takes its own run of it
+    int shardIndex = 1;
+    int shardCount = 1;
+    
+    if (parser.isSet(shardOption)) {
+        QStringList shard = parser.value(shardOption).split("/");
+        shardIndex = shard.size() == 2 ? shard.at(0).toInt() : 0;
+        shardCount = shard.size() == 2 ? shard.at(1).toInt() : 0;
+        if (shardCount <= 0 || shardIndex < 1 || shardIndex > shardCount) {
+            std::cout << "The shard must be given as i/N with i from 1 to N." << std::endl;
+            return -1;
+        }
+        if (statisticsFlag == false) {
+            std::cout << "You must specify a --statistics file for the shard to be merged." << std::endl;
+            return -1;
+        }
+        
+        //Shards started in the same folder in the same minute would otherwise append to the same default files
+        QString shardSuffix = QString("_shard%1of%2.txt").arg(shardIndex).arg(shardCount);
+        if (loglistFileFlag == false) {
+            loglistFilePath.replace(loglistFilePath.length() - 4, 4, shardSuffix);
+        }
+        if (resultFilePathFlag == false) {
+            resultFilePath.replace(resultFilePath.length() - 4, 4, shardSuffix);
+        }
+    }
+    
+    //Watching starts before the scan so no frame landing during it is missed
+    bool watchFlag = parser.isSet(watchOption);
+    
+    if (watchFlag == true && shardCount > 1) {
+        std::cout << "A sharded run can't watch for new frames." << std::endl;
+        return -1;
+    }
+    HDRFolderWatcher folderWatcher;
+    
+    if (watchFlag == true) {
+        if (!folderWatcher.start(std::string(scanPath.toLocal8Bit().data()))) {
+            std::cout << "Unable to watch " << scanPath.toLatin1().data() << " for new frames." << std::endl;
+            return -1;
+        }
+        runningFolderWatcher = &folderWatcher;
+        signal(SIGINT, stopWatchingOnSignal);
+        signal(SIGTERM, stopWatchingOnSignal);
+    }
+    
     std::cout << "Scanning Files... " << std::endl;
 
-    //Scan the directory and collect all of the files to process
-    QStringList foundTiffFiles = getListOfTiffFilesFromPath(scanPath);
+    //Scan the directory and collect all of the files to process. Unless a mandatory file list or the
+    //active area probe needs every file up front, the frames go to the workers as the scan finds them.
+    bool streamFoundFiles = mandatoryFileListFilesFlag == false && shardCount == 1 &&
+        (parser.isSet(yOffsetOption) == true || parser.isSet(yLengthOption) == true || parser.isSet(adaptiveAreaOption) == true);
+    
+    QStringList foundTiffFiles;
+    std::unique_ptr<HDRDirectoryScanner> scanner;
+    
+    if (streamFoundFiles == true) {
+        scanner.reset(new HDRDirectoryScanner(std::string(scanPath.toLocal8Bit().data()), DIRECTORY_SCAN_THREADS));
+    } else {
+        foundTiffFiles = getListOfTiffFilesFromPath(scanPath);
+    }
     
     //We need to make sure that the mandatory files exist in either
     if (mandatoryFileListFilesFlag == true) {
@@ -584,15 +849,20 @@ int main(int argc, const char * argv[]) {
         
     }
     
-    //Get all of the processed files so far if any and remove them from the list of found files
+    //Get all of the processed files so far if any and remove them from the list of found files, or from the frames as they are found
+    FilePathMap processedFilesMap;
+    
     if (processedFilesFlag == true) {
-        QStringList processedFilesList = getListOfFilesFromFileStream(processedFilesFilePath);
+        QStringList processedFilesList = getListOfFilesFromResultJournal(processedFilesFilePath);
+        if (processedFilesList.count() == 0) {
+            processedFilesList = getListOfFilesFromFileStream(processedFilesFilePath);
+        }
         if (processedFilesList.count() == 0) {
             std::cout << "Unable to open the processed file log OR the file was empty." << std::endl;
             return -1;
         }
         
-        FilePathMap processedFilesMap = getMapOfFilesFromList(processedFilesList);
+        processedFilesMap = getMapOfFilesFromList(processedFilesList);
         FilePathMap foundTiffFilesMap = getMapOfFilesFromList(foundTiffFiles);
         QStringList foundFilesMinusProcessed;
         
@@ -608,19 +878,97 @@ int main(int argc, const char * argv[]) {
         foundTiffFiles = foundFilesMinusProcessed;
     }
     
+    int numberOfThreads = 4;
+    
+    if (parser.isSet(threadCountOption)) {
+        numberOfThreads = atoi(parser.value(threadCountOption).toLatin1().data());
+    }
+    
+    //Without I/O threads every thread both reads and computes, -t alone counts them
+    if (parser.isSet(computeThreadCountOption) && parser.isSet(ioThreadCountOption)) {
+        numberOfThreads = atoi(parser.value(computeThreadCountOption).toLatin1().data());
+    } else if (parser.isSet(computeThreadCountOption)) {
+        std::cout << "The compute threads only apply with --io-threads, ignoring them." << std::endl;
+    }
+    
+    if (numberOfThreads <= 0) {
+        std::cout << "You must specify a number of threads greater than 0." << std::endl;
+        return -1;
+    }
+    
+    //With I/O threads the frames are prefetched into a pool of buffers and numberOfThreads only compute
+    int numberOfIOThreads = 0;
+    
+    if (parser.isSet(ioThreadCountOption)) {
+        numberOfIOThreads = atoi(parser.value(ioThreadCountOption).toLatin1().data());
+        if (numberOfIOThreads <= 0) {
+            std::cout << "You must specify a number of I/O threads greater than 0." << std::endl;
+            return -1;
+        }
+    }
+    
+    //The histograms are filled by the worker that owns each frame and written in file order by the result writer, so no bins are shared between threads
+    bool histogramFlag = parser.isSet(histogramOption);
+    bool adaptiveAreaFlag = parser.isSet(adaptiveAreaOption);
+    bool previewFlag = parser.isSet(previewOption);
+    
+    if (previewFlag == true && adaptiveAreaFlag == true) {
+        std::cout << "A preview can't find the active area of every frame, use it without --adaptive-area." << std::endl;
+        return -1;
+    }
+    
+    //A preview reads a few strips straight into the kernel, there is no whole frame for I/O threads to prefetch
+    if (previewFlag == true && numberOfIOThreads > 0) {
+        std::cout << "Previews are read on the compute threads, ignoring the I/O threads." << std::endl;
+        numberOfIOThreads = 0;
+    }
+    QString histogramFilePath = histogramFlag ? QFileInfo(parser.value(histogramOption)).absoluteFilePath() : QString();
+    
+    //Specialized kernel and lookup table for the colour space and range, or the scene-linear scale, chosen once for the whole job
+    HDRColorSpace colorSpace = use2020 ? HDRColorSpaceBT2020 : HDRColorSpaceP3D65;
+    HDRLightLevelKernel kernel = sceneLinearFlag ? selectSceneLinearLightLevelKernel(colorSpace, sceneLinearNits, histogramFlag) :
+                                                   selectLightLevelKernel(colorSpace, useFull ? HDRSignalRangeFull : HDRSignalRangeLegal, histogramFlag);
+    
+    //Sampled files measured by the probe, reused by the main run when it settles on the same rows
+    std::map<QString, HDRActiveAreaProbe> probedFiles;
+    
     /***** Create a map of active areas from a sampling of the files *****/
     /***** Check this if the user hasn't specifically specified a y offset or length amount *****/
 
-    if(parser.isSet(yOffsetOption) == false && parser.isSet(yLengthOption) == false){
+    if(parser.isSet(yOffsetOption) == false && parser.isSet(yLengthOption) == false && adaptiveAreaFlag == false){
         
         std::cout << "Scanning Active Dimensions... " << std::endl;
         
         QMap<QString, HDRActiveAreaSetMember> activeAreaResultMap;
         int numberOfFilesToCheck = 10;
         int countOfFilesToCheck = foundTiffFiles.size() > numberOfFilesToCheck ? numberOfFilesToCheck : foundTiffFiles.size();
-        for (int i = 0; i < countOfFilesToCheck; i++){
-            int index = getRandomNumber(0,foundTiffFiles.size() - 1);
-            std::pair<int, int> result = getActiveAreaDimensionsForFilePath(foundTiffFiles.at(index).toLatin1().data());
+        
+        //The samples are drawn on this thread, whose random sequence is the same on every run, so every
+        //shard of a reel samples the same files. They are probed concurrently on the worker pool and tallied here.
+        QStringList filesToCheck;
+        for (int i = 0; i < countOfFilesToCheck; i++) {
+            filesToCheck << foundTiffFiles.at(getRandomNumber(0,foundTiffFiles.size() - 1));
+        }
+        
+        int checkedFiles = 0;
+        
+        auto nextFileToCheck = [&](QString & path){
+            if (checkedFiles >= filesToCheck.size()) {
+                return false;
+            }
+            path = filesToCheck.at(checkedFiles++);
+            return true;
+        };
+        
+        auto probeActiveArea = [&](const QString & path){
+            QByteArray array = path.toLocal8Bit();
+            return probeActiveAreaForPath((const char *)array.data(), kernel, previewFlag);
+        };
+        
+        auto tallyActiveArea = [&](const QString & path, const HDRActiveAreaProbe & probe){
+            
+            const std::pair<int, int> & result = probe.dimensions;
+            probedFiles[path] = probe;
             
             std::stringstream resultString;
             resultString << result.first << "," << result.second;
@@ -634,7 +982,9 @@ int main(int argc, const char * argv[]) {
                 activeAreaResultMap[qResultString] = {result.first, result.second, 1};
             }
         
-        }
+        };
+        
+        processFramesInOrder<QString, HDRActiveAreaProbe>(numberOfThreads, numberOfThreads * 4, nextFileToCheck, probeActiveArea, tallyActiveArea);
         
     
         QMapIterator<QString, HDRActiveAreaSetMember> i(activeAreaResultMap);
@@ -685,7 +1035,7 @@ int main(int argc, const char * argv[]) {
     //LIFTED END
 
     //This is a sanity check
-    if (yLength == 0) {
+    if (yLength == 0 && adaptiveAreaFlag == false) {
         std::cout << "You must specify a vertical pixel length greater than 0, i.e. -d 1600." << std::endl;
         return -1;
     }
@@ -693,19 +1043,9 @@ int main(int argc, const char * argv[]) {
     std::cout << "Will begin processing the path " << scanPath.toLatin1().data() << ":" << std::endl;
     std::cout  << "The following parameters:" << std::endl;
     
-    int numberOfThreads = 4;
-    
-    if (parser.isSet(threadCountOption)) {
-        numberOfThreads = atoi(parser.value(threadCountOption).toLatin1().data());
-    }
-    
-    if (numberOfThreads == 0) {
-        std::cout << "You must specify a y length greater than 0." << std::endl;
-        //qDebug() << "You must specify a number of threads greater than 0.";
-        return -1;
-    }
-    
-    if (useFull == true) {
+    if (sceneLinearFlag == true) {
+        std::cout << "\t" << "Scene Linear 1.0 = " << sceneLinearNits << " cd/m2" << std::endl;
+    } else if (useFull == true) {
         std::cout << "\t" << "Use Full Range" << std::endl;
     } else {
         std::cout << "\t" << "Use Legal Range" << std::endl;
@@ -717,18 +1057,81 @@ int main(int argc, const char * argv[]) {
         std::cout << "\t" << "Use P3 Color Space" << std::endl;
     }
     
-    std::cout << "\t" << "yOffset" << " " << yOffset << std::endl;
-    std::cout << "\t" << "y length" << " " << yLength  << std::endl;
+    if (adaptiveAreaFlag == true) {
+        std::cout << "\t" << "Adaptive active area" << std::endl;
+    } else {
+        std::cout << "\t" << "yOffset" << " " << yOffset << std::endl;
+        std::cout << "\t" << "y length" << " " << yLength  << std::endl;
+    }
     std::cout << "\t" << "loglistFilePath" << " " << loglistFilePath.toLatin1().data()  << std::endl;
     std::cout << "\t" << "processedFilesFilePath" << " " << processedFilesFilePath.toLatin1().data()  << std::endl;
     std::cout << "\t" << "resultFilePath" << " " << resultFilePath.toLatin1().data() << std::endl;
     std::cout << "\t" << "numberOfThreads" << " " << numberOfThreads << std::endl;
+    std::cout << "\t" << "numberOfIOThreads" << " " << numberOfIOThreads << std::endl;
+    
+    if (parser.isSet(hugePagesOption)) {
+        setBufferArenaUsesHugePages(true);
+        std::cout << "\t" << "Use Huge Pages" << std::endl;
+    }
+    if (parser.isSet(noMappedReadsOption)) {
+        setMappedTiffReadsEnabled(false);
+        std::cout << "\t" << "No Mapped Reads" << std::endl;
+    }
+    std::cout << "\t" << "kernel" << " " << lightLevelKernelName(selectedLightLevelKernelISA()) << std::endl;
+    
+    bool binaryResultsFlag = parser.isSet(binaryResultsOption);
+    QString binaryResultsFilePath = binaryResultsFlag ? QFileInfo(parser.value(binaryResultsOption)).absoluteFilePath() : QString();
+    
+    if (binaryResultsFlag == true) {
+        std::cout << "\t" << "binaryResultsFilePath" << " " << binaryResultsFilePath.toLatin1().data() << std::endl;
+    }
+    
+    bool resumeFlag = parser.isSet(resumeOption);
+    
+    if (resumeFlag == true && binaryResultsFlag == false) {
+        std::cout << "You must specify a journal with --binary-results to resume from." << std::endl;
+        return -1;
+    }
+    
+    bool cacheFlag = parser.isSet(cacheOption);
+    bool cacheVerifyFlag = parser.isSet(cacheVerifyOption);
+    QString cacheFilePath = cacheFlag ? QFileInfo(parser.value(cacheOption)).absoluteFilePath() : QString();
+    
+    if (cacheFlag == true) {
+        std::cout << "\t" << "cacheFilePath" << " " << cacheFilePath.toLatin1().data() << std::endl;
+    }
+    
+    //The cache doesn't keep luminance histograms
+    if (cacheFlag == true && histogramFlag == true) {
+        std::cout << "The result cache isn't used while writing luminance histograms." << std::endl;
+        cacheFlag = false;
+    }
+    
+    //Nor does the journal, resumed frames would leave the sidecar without their records
+    if (resumeFlag == true && histogramFlag == true) {
+        std::cout << "A run writing luminance histograms can't be resumed, use --histogram without --resume." << std::endl;
+        return -1;
+    }
+    
+    if (histogramFlag == true) {
+        std::cout << "\t" << "histogramFilePath" << " " << histogramFilePath.toLatin1().data() << std::endl;
+    }
     
     //LIFTED
     
     //OK, now ready to process files
     
-    std::cout << "Ready to process: " << foundTiffFiles.size() << " files." << std::endl;
+    //The shard's run of the list, the whole list unsharded. The active area probe above sampled the whole list, so every shard settles on the same rows.
+    int firstFileIndex = (int)(((long long)foundTiffFiles.size() * (shardIndex - 1)) / shardCount);
+    int endFileIndex = (int)(((long long)foundTiffFiles.size() * shardIndex) / shardCount);
+    
+    if (streamFoundFiles == true) {
+        std::cout << "Ready to process files as they are found." << std::endl;
+    } else if (shardCount > 1) {
+        std::cout << "Ready to process: " << (endFileIndex - firstFileIndex) << " files, " << (firstFileIndex + 1) << " to " << endFileIndex << " of " << foundTiffFiles.size() << " as shard " << shardIndex << " of " << shardCount << "." << std::endl;
+    } else {
+        std::cout << "Ready to process: " << foundTiffFiles.size() << " files." << std::endl;
+    }
     
     //Create log file
     QFile fileLogFile(loglistFilePath);
@@ -749,55 +1152,322 @@ int main(int argc, const char * argv[]) {
     
     QTextStream resultFileStream(&resultLogFile);
     
-    //define active area
+    //define active area, the whole frame when every frame finds its own
     HDRActiveArea area = {0, yOffset, 0, yLength};
+    if (adaptiveAreaFlag == true) {
+        area.y = 0;
+        area.height = 0;
+    }
     
-    bool singleThreaded = false;
+    FILE * histogramFile = NULL;
+    if (histogramFlag == true) {
+        histogramFile = createLuminanceHistogramSidecar(histogramFilePath.toLocal8Bit().data());
+        if (!histogramFile) {
+            std::cout << "Can't open histogram file path" << std::endl;
+            return -1;
+        }
+    }
     
-    if (singleThreaded || foundTiffFiles.size() < numberOfThreads) {
-        
-        for (int i = 0; i < foundTiffFiles.size(); i++) {
-            QString nextTiffFile = foundTiffFiles.at(i);
-            HDRMetaDataResult result = calculateMetadataForPath((const char *)nextTiffFile.toLatin1().data(), use2020, useFull, area);
-            resultFileStream << nextTiffFile << "\t" << result.maxFALL << "\t"  << result.maxCLL << "\n";
-            logFileStream << nextTiffFile << "\t" << QDateTime::currentDateTime().toString().toLatin1().data() << "\n";
+    HDRResultJournal resultJournal = {NULL, NULL, 0, 0, std::chrono::steady_clock::now()};
+    if (binaryResultsFlag == true && !openResultJournal(&resultJournal, binaryResultsFilePath.toLocal8Bit().data())) {
+        std::cout << "Can't open binary results file path" << std::endl;
+        return -1;
+    }
+    
+    //Mapped after opening for append, which may have cut off a torn record. Appends don't disturb the mapping.
+    HDRResultJournalView resumeView;
+    memset(&resumeView, 0, sizeof(resumeView));
+    HDRResultJournalIndex * resumeIndex = NULL;
+    int resumedFrames = 0;
+    
+    if (resumeFlag == true) {
+        std::chrono::steady_clock::time_point reconcileStart = std::chrono::steady_clock::now();
+        mapResultJournal(&resumeView, binaryResultsFilePath.toLocal8Bit().data());
+        resumeIndex = new HDRResultJournalIndex(&resumeView);
+        double reconcileSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - reconcileStart).count();
+        std::cout << "Resume journal holds " << resumeIndex->size() << " files, indexed in " << reconcileSeconds << " s" << std::endl;
+    }
+    
+    HDRResultCache resultCache;
+    int cachedFrames = 0;
+    
+    if (cacheFlag == true) {
+        if (!resultCache.open(cacheFilePath.toLocal8Bit().data())) {
+            std::cout << "Can't open cache file path" << std::endl;
+            return -1;
         }
+        std::cout << "Result cache holds " << resultCache.size() << " frames" << std::endl;
+    }
+    
+    //The active rows are part of the key, frames measured over other rows miss
+    HDRResultCacheParameters cacheParameters;
+    memset(&cacheParameters, 0, sizeof(cacheParameters));
+    cacheParameters.signalRange = useFull ? HDRSignalRangeFull : HDRSignalRangeLegal;
+    cacheParameters.colorSpace = use2020 ? HDRColorSpaceBT2020 : HDRColorSpaceP3D65;
+    cacheParameters.activeY = area.y;
+    cacheParameters.activeHeight = area.height;
+    cacheParameters.adaptiveArea = adaptiveAreaFlag;
+    cacheParameters.preview = previewFlag;
+    cacheParameters.sceneLinearNits = (float)sceneLinearNits;
+    
+    //Journaled results measured with other settings aren't resumed from
+    uint32_t resultParameters = resultParametersHash(cacheParameters);
+    
+    //Workers pull files continuously, results are written back in file order
+    int nextFileIndex = firstFileIndex;
+    
+    //Timed per frame by the workers and added up as the results are written
+    HDRRunMetrics runMetrics;
+    runMetrics.setExpectedFrames(streamFoundFiles == false && watchFlag == false ? endFileIndex - firstFileIndex : 0);
+    int reusedProbeResults = 0;
+    
+    bool watchingAnnounced = false;
+    
+    auto nextFilePath = [&](QString & path, bool & watched){
         
-    } else {
-        
-        int mod = foundTiffFiles.size() % numberOfThreads;
-        int max = foundTiffFiles.size();
-        int maxNormal = foundTiffFiles.size() - mod;
+        watched = false;
+        std::string next;
         
-        for (int i = 0; i < maxNormal; i += numberOfThreads) {
-            
-            QList<HDRUserData> userDataList;
-            
-            for (int y = 0; y < numberOfThreads; y++) {
-                HDRUserData data = {foundTiffFiles.at(i + y), use2020, useFull, area};
-                userDataList << data;
+        if (streamFoundFiles == false) {
+            if (nextFileIndex < endFileIndex) {
+                path = foundTiffFiles.at(nextFileIndex++);
+                return true;
             }
-            
-            QList<HDRFileResultPair> results = QtConcurrent::blockingMapped(userDataList, calculateMetadataForPathConcurrently);
-            qSort(results.begin(), results.end(), sortHDRUserDataFilePath);
-            
-            QListIterator<HDRFileResultPair> iter(results);
-            while (iter.hasNext()) {
-                HDRFileResultPair result = iter.next();
-                resultFileStream << result.first << "\t" << result.second.maxFALL << "\t"  << result.second.maxCLL << "\n";
-                logFileStream << result.first << "\t" << QDateTime::currentDateTime().toString().toLatin1().data() << "\n";
+        } else {
+            while (scanner->next(next)) {
+                path = QString::fromLocal8Bit(next.c_str());
+                if (processedFilesFlag == true && processedFilesMap.contains(path.split("/").last())) {
+                    continue;
+                }
+                nextFileIndex++;
+                return true;
             }
-            
         }
         
-        for (int i = maxNormal; i < max; i++) {
-            QString nextTiffFile = foundTiffFiles.at(i);
-            HDRMetaDataResult result = calculateMetadataForPath((const char *)nextTiffFile.toLatin1().data(), use2020, useFull, area);
-            resultFileStream << nextTiffFile << "\t" << result.maxFALL << "\t"  << result.maxCLL << "\n";
-            logFileStream << nextTiffFile << "\t" << QDateTime::currentDateTime().toString().toLatin1().data() << "\n";
+        //Waits here until the next frame lands or the watch is stopped
+        if (watchFlag == true && watchingAnnounced == false) {
+            std::cout << "Watching for new frames, interrupt to finish." << std::endl;
+            watchingAnnounced = true;
+        }
+        if (watchFlag == true && folderWatcher.next(next)) {
+            path = QString::fromLocal8Bit(next.c_str());
+            watched = true;
+            nextFileIndex++;
+            return true;
+        }
+        return false;
+    };
+    
+    auto nextUserData = [&](HDRUserData & data){
+        if (!nextFilePath(data.filePath, data.watched)) {
+            return false;
+        }
+        runMetrics.framePulled();
+        data.kernel = kernel;
+        data.activeArea = area;
+        data.adaptiveArea = adaptiveAreaFlag;
+        data.preview = previewFlag;
+        data.probeResult = NULL;
+        data.resumeRecord = NULL;
+        data.cache = resultCache.isOpen() ? &resultCache : NULL;
+        data.cacheParameters = cacheParameters;
+        data.verifyCache = cacheVerifyFlag;
+        
+        //Frames that failed before are measured again, as are previews since the journal doesn't keep their standard error
+        if (resumeIndex && previewFlag == false) {
+            QByteArray array = data.filePath.toLocal8Bit();
+            long long record = resumeIndex->find(array.data(), array.size());
+            bool sameMode = record != -1 && ((resumeView.records[record].flags & RESULT_JOURNAL_FLAG_PREVIEW) != 0) == previewFlag &&
+                            resumeView.records[record].parametersHash == resultParameters &&
+                            (adaptiveAreaFlag || (resumeView.records[record].activeY == area.y && resumeView.records[record].activeHeight == area.height));
+            if (sameMode && resumeView.records[record].maxFALL >= 0.0 && resumeView.records[record].maxCLL >= 0.0) {
+                data.resumeRecord = &resumeView.records[record];
+            }
+        }
+        
+        std::map<QString, HDRActiveAreaProbe>::const_iterator probed = probedFiles.find(data.filePath);
+        if (probed != probedFiles.end() && probed->second.dimensions.first == area.y && probed->second.dimensions.second == area.height) {
+            data.probeResult = &probed->second.result;
+            reusedProbeResults++;
+        }
+        return true;
+    };
+    
+    //Reel level statistics, the same size for any number of frames
+    HDRLightLevelStatistics * statistics = new HDRLightLevelStatistics;
+    resetLightLevelStatistics(statistics);
+    
+    //In watch mode a frame that lands again replaces its earlier light levels, and the statistics are gathered again from every frame's latest
+    std::map<QString, HDRFrameLightLevels> watchedFrameLevels;
+    
+    auto addToStatistics = [&](const HDRUserData & data, const HDRMetaDataResult & result){
+        
+        if (watchFlag == false) {
+            addFrameToLightLevelStatistics(statistics, result.maxFALL, result.maxCLL, result.maxPixelCLL);
+            return;
+        }
+        
+        HDRFrameLightLevels levels = {result.maxFALL, result.maxCLL, result.maxPixelCLL};
+        std::pair<std::map<QString, HDRFrameLightLevels>::iterator, bool> inserted = watchedFrameLevels.insert(std::make_pair(data.filePath, levels));
+        if (inserted.second) {
+            addFrameToLightLevelStatistics(statistics, levels.maxFALL, levels.maxCLL, levels.maxPixelCLL);
+            return;
+        }
+        
+        inserted.first->second = levels;
+        resetLightLevelStatistics(statistics);
+        for (std::map<QString, HDRFrameLightLevels>::const_iterator frame = watchedFrameLevels.begin(); frame != watchedFrameLevels.end(); ++frame) {
+            addFrameToLightLevelStatistics(statistics, frame->second.maxFALL, frame->second.maxCLL, frame->second.maxPixelCLL);
+        }
+    };
+    
+    //The frame behind the estimated reel maxFALL of a preview and how far off it may be
+    double previewMaxFALL = 0.0;
+    double previewMaxFALLStandardError = 0.0;
+    
+    auto writeResult = [&](const HDRUserData & data, const HDRMetaDataResult & result){
+        
+        //Already written by the earlier run, only the reel statistics need it
+        if (result.resumed) {
+            addToStatistics(data, result);
+            resumedFrames++;
+            return;
         }
         
+        resultFileStream << data.filePath << "\t" << result.maxFALL << "\t"  << result.maxCLL << "\t" << result.maxPixelCLL;
+        if (previewFlag == true) {
+            resultFileStream << "\t" << result.maxFALLStandardError;
+        }
+        resultFileStream << "\n";
+        if (result.maxFALL >= 0.0 && result.maxFALL > previewMaxFALL) {
+            previewMaxFALL = result.maxFALL;
+            previewMaxFALLStandardError = result.maxFALLStandardError;
+        }
+        addToStatistics(data, result);
+        if (result.cached) {
+            cachedFrames++;
+        } else if (result.cacheKey != 0 && result.maxFALL >= 0.0 && result.maxCLL >= 0.0) {
+            HDRResultCacheRecord record;
+            memset(&record, 0, sizeof(record));
+            record.key = result.cacheKey;
+            record.maxFALL = result.maxFALL;
+            record.maxCLL = result.maxCLL;
+            record.maxPixelCLL = result.maxPixelCLL;
+            record.maxFALLStandardError = result.maxFALLStandardError;
+            record.activeY = result.activeY;
+            record.activeHeight = result.activeHeight;
+            resultCache.add(record);
+        }
+        if (resultJournal.records) {
+            HDRResultRecord record;
+            memset(&record, 0, sizeof(record));
+            record.activeY = result.activeY;
+            record.activeHeight = result.activeHeight;
+            record.identity = result.fileIdentity;
+            record.flags = previewFlag ? RESULT_JOURNAL_FLAG_PREVIEW : 0;
+            record.parametersHash = resultParameters;
+            record.maxFALL = result.maxFALL;
+            record.maxCLL = result.maxCLL;
+            record.maxPixelCLL = result.maxPixelCLL;
+            appendResultJournalRecord(&resultJournal, data.filePath.toLocal8Bit().data(), record);
+        }
+        if (histogramFile) {
+            writeLuminanceHistogramRecord(histogramFile, data.filePath.toLocal8Bit().data(), result.luminanceHistogram);
+        }
+        logFileStream << data.filePath << "\t" << QDateTime::currentDateTime().toString().toLatin1().data();
+        if (adaptiveAreaFlag == true) {
+            logFileStream << "\t" << result.activeY << "," << result.activeHeight;
+        }
+        logFileStream << "\n";
         
+        //Frames that land while watching are on disk and on screen as soon as they are measured
+        if (data.watched) {
+            resultFileStream.flush();
+            logFileStream.flush();
+            std::cout << data.filePath.toLatin1().data() << "\t" << result.maxFALL << "\t" << result.maxCLL
+                      << "\t" << "MaxFALL " << ceil(statistics->maxFALL) << " MaxCLL " << ceil(statistics->maxCLL) << " over " << statistics->frameCount << " frames" << std::endl;
+        }
+    };
+    
+    //Every stage reports its frames so the progress line can show where they queue up
+    auto loadUserData = [&](const HDRUserData & data, HDRFrameBuffer & frame){
+        loadActiveAreaForUserData(data, frame);
+        runMetrics.frameLoaded();
+    };
+    
+    auto computeUserDataFrame = [&](const HDRUserData & data, HDRFrameBuffer & frame) -> HDRMetaDataResult {
+        HDRMetaDataResult result = calculateMetadataForUserDataFrame(data, frame);
+        runMetrics.frameComputed();
+        return result;
+    };
+    
+    auto computeUserData = [&](const HDRUserData & data) -> HDRMetaDataResult {
+        HDRMetaDataResult result = calculateMetadataForUserData(data);
+        runMetrics.frameComputed();
+        return result;
+    };
+    
+    auto writeTimedResult = [&](const HDRUserData & data, const HDRMetaDataResult & result){
+        uint64_t start = monotonicNanoseconds();
+        writeResult(data, result);
+        runMetrics.addFrame(result.timings, monotonicNanoseconds() - start, result.fileIdentity.size, result.resumed || result.cached, result.maxFALL < 0.0);
+    };
+    
+    if (progressFlag == true || metricsFlag == true) {
+        runMetrics.startReporting(progressFlag, metricsFlag ? metricsFilePath.toLocal8Bit().data() : NULL);
+    }
+    
+    if (numberOfIOThreads > 0) {
+        //Each I/O thread can have one frame loading and one waiting on top of the frames being computed
+        int numberOfFrameBuffers = numberOfThreads + (2 * numberOfIOThreads);
+        processFramesInOrderPipelined<HDRUserData, HDRFrameBuffer, HDRMetaDataResult>(numberOfIOThreads, numberOfThreads, numberOfFrameBuffers, numberOfFrameBuffers * 4,
+                                                                                      nextUserData, loadUserData, computeUserDataFrame, writeTimedResult);
+    } else {
+        processFramesInOrder<HDRUserData, HDRMetaDataResult>(numberOfThreads, numberOfThreads * 4, nextUserData, computeUserData, writeTimedResult);
+    }
+    
+    runningFolderWatcher = NULL;
+    
+    if (runMetrics.stopReporting() == false) {
+        std::cout << "Can't write the metrics file" << std::endl;
+    }
+    
+    //Pixel buffers are only allocated while the threads and frame pool warm up, not per frame
+    HDRBufferArenaCounters arenaCounters = bufferArenaCounters();
+    std::cout << "Files measured during the active area probe: " << reusedProbeResults << std::endl;
+    std::cout << "Pixel buffer allocations: " << arenaCounters.allocations << " (" << (arenaCounters.bytes / (1024 * 1024)) << " MB) for " << (nextFileIndex - firstFileIndex) << " files" << std::endl;
+    
+    printLightLevelStatistics(statistics);
+    printRunMetrics(runMetrics.snapshot());
+    
+    if (previewFlag == true) {
+        std::cout << "Preview of 1 in " << PREVIEW_STRIP_STRIDE << " strips: MaxFALL within about " << ceil(2.0 * previewMaxFALLStandardError) << " cd/m2 of the full measurement (two standard errors), MaxCLL values are lower bounds" << std::endl;
+    }
+    
+    if (statisticsFlag == true) {
+        if (writeLightLevelStatistics(statisticsFilePath.toLocal8Bit().data(), statistics, shardIndex, shardCount)) {
+            std::cout << "Statistics of shard " << shardIndex << " of " << shardCount << " written to " << statisticsFilePath.toLatin1().data() << std::endl;
+        } else {
+            std::cout << "Can't write the statistics file" << std::endl;
+        }
+    }
+    delete statistics;
+    
+    if (histogramFile) {
+        fclose(histogramFile);
+    }
+    
+    closeResultJournal(&resultJournal);
+    
+    if (resultCache.isOpen()) {
+        std::cout << "Results taken from the cache: " << cachedFrames << std::endl;
+        resultCache.close();
+    }
+    
+    if (resumeIndex) {
+        std::cout << "Resumed " << resumedFrames << " files measured by an earlier run" << std::endl;
+        delete resumeIndex;
+        unmapResultJournal(&resumeView);
     }
     
     std::cout << "Finished!" << std::endl;
@@ -5,4 +5,4 @@
 
 export LD_LIBRARY_PATH=/usr/lib64:/usr/local/lib
 export PKG_CONFIG_PATH=/usr/lib64/pkgconfig:/usr/local/lib/pkgconfig
-g++ -fPIC -Wall -ldl -std=c++0x hdrgenerator.cpp activedimensions.cpp -o hdrgenerator -lOpenImageIO $(pkg-config --cflags --libs Qt5Core Qt5Concurrent opencv)
+g++ -fPIC -Wall -O2 -ffp-contract=off -ldl -std=c++0x -pthread hdrgenerator.cpp framemetadata.cpp tiffmapping.cpp scenelinear.cpp runmetrics.cpp activedimensions.cpp activerows.cpp lightlevelmeter.cpp luminancekernel.cpp pqlookup.cpp bufferarena.cpp lightlevelstats.cpp luminancehistogram.cpp adaptivearea.cpp resultjournal.cpp fileidentity.cpp resultcache.cpp directoryscan.cpp folderwatch.cpp previewsampling.cpp -o hdrgenerator -lOpenImageIO $(pkg-config --cflags --libs Qt5Core)
@@ -0,0 +1,155 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <new>
+
+#include "hdrmeta.h"
+#include "lightlevelmeter.h"
+
+struct HDRMetaMeter {
+    HDRLightLevelMeter meter;
+    HDRMetaMeter(HDRColorSpace colorSpace, HDRSignalRange signalRange) : meter(colorSpace, signalRange) {}
+};
+
+struct HDRMetaReel {
+    HDRReelLightLevels reel;
+};
+
+//Copied field by field so HDRMetaFrame and HDRFrameView can each change without the other
+static bool frameViewForFrame(const HDRMetaFrame * frame, HDRFrameView & view){
+    
+    if (!frame || (frame->format != HDRMETA_SAMPLE_UINT16 && frame->format != HDRMETA_SAMPLE_HALF && frame->format != HDRMETA_SAMPLE_FLOAT)) {
+        return false;
+    }
+    
+    view.pixels = frame->pixels;
+    view.format = frame->format == HDRMETA_SAMPLE_HALF ? HDRSampleHalf : (frame->format == HDRMETA_SAMPLE_FLOAT ? HDRSampleFloat : HDRSampleUInt16);
+    view.width = frame->width;
+    view.height = frame->height;
+    view.channels = frame->channels;
+    view.rowStride = frame->rowStride;
+    
+    return true;
+}
+
+int hdrMetaVersion(void){
+    return HDRMETA_VERSION;
+}
+
+HDRMetaMeter * hdrMetaCreateMeter(int colorSpace, int signalRange){
+    
+    if ((colorSpace != HDRMETA_COLOR_SPACE_BT2020 && colorSpace != HDRMETA_COLOR_SPACE_P3D65) ||
+        (signalRange != HDRMETA_SIGNAL_RANGE_FULL && signalRange != HDRMETA_SIGNAL_RANGE_LEGAL)) {
+        return NULL;
+    }
+    
+    return new (std::nothrow) HDRMetaMeter(colorSpace == HDRMETA_COLOR_SPACE_P3D65 ? HDRColorSpaceP3D65 : HDRColorSpaceBT2020,
+                                           signalRange == HDRMETA_SIGNAL_RANGE_LEGAL ? HDRSignalRangeLegal : HDRSignalRangeFull);
+}
+
+void hdrMetaDestroyMeter(HDRMetaMeter * meter){
+    delete meter;
+}
+
+int hdrMetaFindActiveRows(const HDRMetaMeter * meter, const HDRMetaFrame * frame, int * y, int * height){
+    
+    HDRFrameView view;
+    if (!meter || !y || !height || !frameViewForFrame(frame, view)) {
+        return HDRMETA_ERROR_INVALID_ARGUMENT;
+    }
+    
+    //No exception leaves the library, the scratch row is the only allocation
+    try {
+        std::pair<int, int> rows = meter->meter.findActiveRows(view);
+        if (rows.first == 0 && rows.second == 0) {
+            return HDRMETA_ERROR_INVALID_ARGUMENT;
+        }
+        *y = rows.first;
+        *height = rows.second;
+    } catch (const std::bad_alloc &) {
+        return HDRMETA_ERROR_OUT_OF_MEMORY;
+    }
+    
+    return HDRMETA_OK;
+}
+
+int hdrMetaMeasure(const HDRMetaMeter * meter, const HDRMetaFrame * frame, int y, int height, int adaptiveArea, HDRMetaLevels * levels){
+    
+    HDRFrameView view;
+    if (!meter || !levels || !frameViewForFrame(frame, view)) {
+        return HDRMETA_ERROR_INVALID_ARGUMENT;
+    }
+    
+    HDRLightLevels measured;
+    try {
+        if (!meter->meter.measure(view, y, height, adaptiveArea != 0, &measured)) {
+            return HDRMETA_ERROR_INVALID_ARGUMENT;
+        }
+    } catch (const std::bad_alloc &) {
+        return HDRMETA_ERROR_OUT_OF_MEMORY;
+    }
+    
+    levels->maxFALL = measured.maxFALL;
+    levels->maxCLL = measured.maxCLL;
+    levels->maxPixelCLL = measured.maxPixelCLL;
+    levels->activeY = measured.activeY;
+    levels->activeHeight = measured.activeHeight;
+    
+    return HDRMETA_OK;
+}
+
+HDRMetaReel * hdrMetaCreateReel(void){
+    try {
+        return new HDRMetaReel;
+    } catch (const std::bad_alloc &) {
+        return NULL;
+    }
+}
+
+void hdrMetaDestroyReel(HDRMetaReel * reel){
+    delete reel;
+}
+
+int hdrMetaAddToReel(HDRMetaReel * reel, const HDRMetaLevels * levels){
+    
+    if (!reel || !levels) {
+        return HDRMETA_ERROR_INVALID_ARGUMENT;
+    }
+    
+    HDRLightLevels frame = {levels->maxFALL, levels->maxCLL, levels->maxPixelCLL, levels->activeY, levels->activeHeight};
+    reel->reel.add(frame);
+    
+    return HDRMETA_OK;
+}
+
+int hdrMetaMergeReels(HDRMetaReel * reel, const HDRMetaReel * other){
+    
+    if (!reel || !other) {
+        return HDRMETA_ERROR_INVALID_ARGUMENT;
+    }
+    
+    reel->reel.merge(other->reel);
+    
+    return HDRMETA_OK;
+}
+
+int hdrMetaGetReelLevels(const HDRMetaReel * reel, double percentile, HDRMetaReelLevels * levels){
+    
+    if (!reel || !levels || !(percentile >= 0.0 && percentile <= 1.0)) {
+        return HDRMETA_ERROR_INVALID_ARGUMENT;
+    }
+    
+    const HDRLightLevelStatistics & statistics = reel->reel.statistics();
+    levels->frameCount = statistics.frameCount;
+    levels->failedFrameCount = statistics.failedFrameCount;
+    levels->maxFALL = statistics.maxFALL;
+    levels->maxCLL = statistics.maxCLL;
+    levels->maxPixelCLL = statistics.maxPixelCLL;
+    levels->maxFALLPercentile = lightLevelStatisticsFALLPercentile(&statistics, percentile);
+    levels->maxCLLPercentile = lightLevelStatisticsCLLPercentile(&statistics, percentile);
+    
+    return HDRMETA_OK;
+}
@@ -0,0 +1,102 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef HDRMETA
+#define HDRMETA
+
+#include <stddef.h>
+
+/*
+ C interface of libhdrmeta, for tools that aren't written in C++ or that load the library at run time.
+ It wraps HDRLightLevelMeter and HDRReelLightLevels (lightlevelmeter.h), which describes how frames are
+ viewed and what the values mean. Structures are only ever extended at the end and the constants keep
+ their values, so code built against an older hdrmeta.h keeps working; HDRMETA_VERSION goes up when
+ something is added.
+
+ Functions returning int return HDRMETA_OK or a negative HDRMETA_ERROR_*. No function keeps a pointer
+ to the caller's pixels after it returns.
+ */
+
+#define HDRMETA_VERSION 1
+
+#define HDRMETA_OK 0
+#define HDRMETA_ERROR_INVALID_ARGUMENT (-1)
+#define HDRMETA_ERROR_OUT_OF_MEMORY (-2)
+
+#define HDRMETA_SAMPLE_UINT16 0
+#define HDRMETA_SAMPLE_HALF 1
+#define HDRMETA_SAMPLE_FLOAT 2
+
+#define HDRMETA_COLOR_SPACE_BT2020 0
+#define HDRMETA_COLOR_SPACE_P3D65 1
+
+#define HDRMETA_SIGNAL_RANGE_FULL 0
+#define HDRMETA_SIGNAL_RANGE_LEGAL 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const void * pixels;        /* First sample of the top left pixel */
+    int format;                 /* HDRMETA_SAMPLE_* */
+    int width;
+    int height;
+    int channels;               /* Samples per pixel, R G B first, at least 3 */
+    ptrdiff_t rowStride;        /* Bytes from the start of one row to the start of the next */
+} HDRMetaFrame;
+
+typedef struct {
+    double maxFALL;             /* cd/m2 */
+    double maxCLL;
+    double maxPixelCLL;         /* maxCLL of the brightest 99.9% of pixels */
+    int activeY;
+    int activeHeight;
+} HDRMetaLevels;
+
+typedef struct {
+    long long frameCount;
+    long long failedFrameCount;
+    double maxFALL;
+    double maxCLL;
+    double maxPixelCLL;
+    double maxFALLPercentile;   /* At the percentile asked for */
+    double maxCLLPercentile;
+} HDRMetaReelLevels;
+
+typedef struct HDRMetaMeter HDRMetaMeter;
+typedef struct HDRMetaReel HDRMetaReel;
+
+/* The HDRMETA_VERSION the library was built with */
+int hdrMetaVersion(void);
+
+/* NULL for an unknown colour space or range */
+HDRMetaMeter * hdrMetaCreateMeter(int colorSpace, int signalRange);
+void hdrMetaDestroyMeter(HDRMetaMeter * meter);
+
+/* Sets y and height to the active rows, both -1 if every row is flat */
+int hdrMetaFindActiveRows(const HDRMetaMeter * meter, const HDRMetaFrame * frame, int * y, int * height);
+
+/* Measures rows [y, y + height), to the bottom of the frame when height is 0. A non-zero adaptiveArea leaves out letterbox rows. */
+int hdrMetaMeasure(const HDRMetaMeter * meter, const HDRMetaFrame * frame, int y, int height, int adaptiveArea, HDRMetaLevels * levels);
+
+HDRMetaReel * hdrMetaCreateReel(void);
+void hdrMetaDestroyReel(HDRMetaReel * reel);
+
+/* Negative values count a frame that couldn't be measured */
+int hdrMetaAddToReel(HDRMetaReel * reel, const HDRMetaLevels * levels);
+
+/* Adds the frames of other, as if they had been added to reel */
+int hdrMetaMergeReels(HDRMetaReel * reel, const HDRMetaReel * other);
+
+/* percentile between 0 and 1, 0.999 for the values the generator prints */
+int hdrMetaGetReelLevels(const HDRMetaReel * reel, double percentile, HDRMetaReelLevels * levels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
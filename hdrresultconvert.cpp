@@ -0,0 +1,69 @@
+//
+//  hdrresultconvert.cpp
+//  HDR GENERATOR TOOL
+//
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "resultjournal.h"
+
+/*
+
+ HDR RESULT CONVERT
+ Writes a binary result journal out as the tab separated text hdrgenerator writes with -n, one line
+ per frame: path, maxFall, maxCLL and the maxCLL of 99.9% of the pixels. Records whose checksum
+ doesn't match are skipped and counted.
+
+ Usage: hdrresultconvert <journal> [<resultFile>]     (writes to stdout without a result file)
+ */
+
+int main(int argc, const char * argv[]) {
+    
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <journal> [<resultFile>]\n", argv[0]);
+        return -1;
+    }
+    
+    HDRResultJournalView view;
+    if (!mapResultJournal(&view, argv[1])) {
+        fprintf(stderr, "Can't read the result journal %s\n", argv[1]);
+        return -1;
+    }
+    
+    FILE * output = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (!output) {
+        fprintf(stderr, "Can't open result file path %s\n", argv[2]);
+        unmapResultJournal(&view);
+        return -1;
+    }
+    
+    size_t skippedRecords = 0;
+    
+    for (size_t i = 0; i < view.recordCount; i++) {
+        
+        if (!resultJournalRecordIsValid(&view, i)) {
+            skippedRecords++;
+            continue;
+        }
+        
+        const HDRResultRecord & record = view.records[i];
+        fwrite(resultJournalRecordPath(&view, i), 1, record.pathLength, output);
+        fprintf(output, "\t%g\t%g\t%g\n", record.maxFALL, record.maxCLL, record.maxPixelCLL);
+    }
+    
+    if (output != stdout) {
+        fclose(output);
+    }
+    
+    fprintf(stderr, "%zu records, %zu skipped\n", view.recordCount, skippedRecords);
+    unmapResultJournal(&view);
+    
+    return skippedRecords > 0 ? 1 : 0;
+}
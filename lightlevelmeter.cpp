@@ -0,0 +1,150 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <string.h>
+
+#include <vector>
+
+#include "lightlevelmeter.h"
+#include "activerows.h"
+#include "adaptivearea.h"
+#include "pqlookup.h"
+#include "scenelinear.h"
+
+HDRLightLevels lightLevelsForAccumulator(const HDRLightLevelAccumulator & accumulator, const float * lookupTable, int width, int y, int height){
+    
+    double maxFALL = lightLevelMaxComponentSum(&accumulator);
+    double maxCLL = accumulator.maxComponent;
+    double maxPixelCLL = lightLevelMaxComponentPercentile(&accumulator, lookupTable, PIXEL_CLL_PERCENTILE);
+    
+    HDRLightLevels levels = {10000.0 * (maxFALL/((double)width*height)), 10000.0 * maxCLL, 10000.0 * maxPixelCLL, y, height};
+    return levels;
+}
+
+static bool frameViewIsValid(const HDRFrameView & frame){
+    return frame.pixels && frame.width > 0 && frame.height > 0 && frame.channels >= ACTIVE_ROW_CHANNELS &&
+           (frame.format == HDRSampleUInt16 || frame.format == HDRSampleHalf || frame.format == HDRSampleFloat);
+}
+
+static inline uint16_t codeForSample(float value){
+    if (!(value > 0.0f)) {
+        return 0;
+    }
+    if (value >= 1.0f) {
+        return 65535;
+    }
+    return (uint16_t)(value * 65535.0f + 0.5f);
+}
+
+//Row y as interleaved RGB16, either in place or converted into scratch
+static const uint16_t * frameRowCodes(const HDRFrameView & frame, int y, std::vector<uint16_t> & scratch){
+    
+    const char * row = (const char *)frame.pixels + (y * frame.rowStride);
+    
+    if (frame.format == HDRSampleUInt16 && frame.channels == ACTIVE_ROW_CHANNELS) {
+        return (const uint16_t *)row;
+    }
+    
+    scratch.resize((size_t)frame.width * ACTIVE_ROW_CHANNELS);
+    uint16_t * codes = scratch.data();
+    
+    for (int x = 0; x < frame.width; x++) {
+        size_t sample = (size_t)x * frame.channels;
+        for (int c = 0; c < ACTIVE_ROW_CHANNELS; c++) {
+            switch (frame.format) {
+                case HDRSampleUInt16:
+                    codes[(x * ACTIVE_ROW_CHANNELS) + c] = ((const uint16_t *)row)[sample + c];
+                    break;
+                case HDRSampleHalf:
+                    codes[(x * ACTIVE_ROW_CHANNELS) + c] = codeForSample(halfToFloat(((const uint16_t *)row)[sample + c]));
+                    break;
+                case HDRSampleFloat:
+                    codes[(x * ACTIVE_ROW_CHANNELS) + c] = codeForSample(((const float *)row)[sample + c]);
+                    break;
+            }
+        }
+    }
+    
+    return codes;
+}
+
+static std::vector<uint16_t> & threadScratchRow(){
+    static thread_local std::vector<uint16_t> scratch;
+    return scratch;
+}
+
+HDRLightLevelMeter::HDRLightLevelMeter(HDRColorSpace colorSpace, HDRSignalRange signalRange) : kernel(selectLightLevelKernel(colorSpace, signalRange, false)) {
+}
+
+std::pair<int, int> HDRLightLevelMeter::findActiveRows(const HDRFrameView & frame) const {
+    
+    if (!frameViewIsValid(frame)) {
+        return std::make_pair(0, 0);
+    }
+    
+    std::vector<uint16_t> & scratch = threadScratchRow();
+    
+    int first = 0;
+    while (first < frame.height && rowIsFlat(frameRowCodes(frame, first, scratch), frame.width)) {
+        first++;
+    }
+    if (first == frame.height) {
+        return std::make_pair(-1, -1);
+    }
+    
+    int last = frame.height - 1;
+    while (last > first && rowIsFlat(frameRowCodes(frame, last, scratch), frame.width)) {
+        last--;
+    }
+    
+    return std::make_pair(first, last + 1 - first);
+}
+
+bool HDRLightLevelMeter::measure(const HDRFrameView & frame, int y, int height, bool adaptiveArea, HDRLightLevels * levels) const {
+    
+    if (!frameViewIsValid(frame) || y < 0 || height < 0 || y + height > frame.height || y >= frame.height) {
+        return false;
+    }
+    if (height == 0) {
+        height = frame.height - y;
+    }
+    
+    std::vector<uint16_t> & scratch = threadScratchRow();
+    
+    HDRLightLevelAccumulator accumulator;
+    resetLightLevelAccumulator(&accumulator);
+    HDRAdaptiveAreaReducer adaptiveReducer(kernel, frame.width, &accumulator);
+    
+    for (int row = 0; row < height; row++) {
+        const uint16_t * codes = frameRowCodes(frame, y + row, scratch);
+        if (adaptiveArea) {
+            adaptiveReducer.reduceRow(codes, row);
+        } else {
+            kernel.reduceRow(codes, frame.width, kernel.lookupTable, &accumulator);
+        }
+    }
+    
+    std::pair<int, int> rows = adaptiveArea ? adaptiveReducer.finish(height) : std::make_pair(0, height);
+    *levels = lightLevelsForAccumulator(accumulator, kernel.lookupTable, frame.width, y + rows.first, rows.second);
+    
+    return true;
+}
+
+HDRReelLightLevels::HDRReelLightLevels() : values(new HDRLightLevelStatistics) {
+    resetLightLevelStatistics(values);
+}
+
+HDRReelLightLevels::~HDRReelLightLevels(){
+    delete values;
+}
+
+void HDRReelLightLevels::add(const HDRLightLevels & levels){
+    addFrameToLightLevelStatistics(values, levels.maxFALL, levels.maxCLL, levels.maxPixelCLL);
+}
+
+void HDRReelLightLevels::merge(const HDRReelLightLevels & other){
+    mergeLightLevelStatistics(values, other.values);
+}
@@ -0,0 +1,98 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef LIGHTLEVELMETER
+#define LIGHTLEVELMETER
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+
+#include "lightlevelstats.h"
+#include "lightleveltraits.h"
+#include "luminancekernel.h"
+
+/*
+ The light level measurement of the generator for frames that are already in memory, so a render or
+ conform tool can measure what it holds without writing frames out and reading them back. Nothing
+ here reads files or depends on OpenImageIO; libhdrmetabuild.sh builds it into libhdrmeta, with the
+ C interface in hdrmeta.h.
+
+ Frames are viewed where they lie, in the caller's memory and layout: interleaved samples with R, G
+ and B first, any number of further channels, and any distance between rows, negative for bottom up
+ frames. 16-bit RGB rows go straight into the kernel. Other layouts and half or float samples are
+ copied a row at a time into a per thread scratch row of 16-bit codes, so nothing the size of a frame
+ is ever copied. Half and float samples are PQ code values normalized to 0..1, 1.0 being code 65535,
+ and are rounded to the nearest code; anything outside 0..1, or NaN, is clamped.
+
+ A meter only holds the kernel and lookup table picked for its colour space and range and can be used
+ from any number of threads at once.
+ */
+
+typedef enum {
+    HDRSampleUInt16 = 0,
+    HDRSampleHalf,
+    HDRSampleFloat
+} HDRSampleFormat;
+
+typedef struct {
+    const void * pixels;        //First sample of the top left pixel
+    HDRSampleFormat format;
+    int width;
+    int height;
+    int channels;               //Samples per pixel, at least 3
+    ptrdiff_t rowStride;        //Bytes from the start of one row to the start of the next
+} HDRFrameView;
+
+#define PIXEL_CLL_PERCENTILE 0.999
+
+typedef struct {
+    double maxFALL;             //cd/m2
+    double maxCLL;
+    double maxPixelCLL;         //maxCLL of the brightest 99.9% of pixels
+    int activeY;                //Rows the values were measured over
+    int activeHeight;
+} HDRLightLevels;
+
+//The light levels of the rows reduced into an accumulator, width pixels wide
+HDRLightLevels lightLevelsForAccumulator(const HDRLightLevelAccumulator & accumulator, const float * lookupTable, int width, int y, int height);
+
+class HDRLightLevelMeter {
+public:
+    HDRLightLevelMeter(HDRColorSpace colorSpace, HDRSignalRange signalRange);
+
+    //Active rows (y, height) as the generator finds them in files, (-1, -1) if every row is flat. (0, 0) for an invalid view.
+    std::pair<int, int> findActiveRows(const HDRFrameView & frame) const;
+
+    //Measures rows [y, y + height), to the bottom of the frame when height is 0. With adaptiveArea the
+    //letterbox rows among them are left out. Returns false if the view or the rows are invalid.
+    bool measure(const HDRFrameView & frame, int y, int height, bool adaptiveArea, HDRLightLevels * levels) const;
+
+private:
+    HDRLightLevelKernel kernel;
+};
+
+//Reel statistics over measured frames, see lightlevelstats.h
+class HDRReelLightLevels {
+public:
+    HDRReelLightLevels();
+    ~HDRReelLightLevels();
+
+    //Frames that couldn't be measured are added with negative values and only counted
+    void add(const HDRLightLevels & levels);
+    void merge(const HDRReelLightLevels & other);
+
+    const HDRLightLevelStatistics & statistics() const { return *values; }
+
+private:
+    HDRReelLightLevels(const HDRReelLightLevels &);
+    HDRReelLightLevels & operator=(const HDRReelLightLevels &);
+
+    HDRLightLevelStatistics * values;   //Too large for the stack of a caller
+};
+
+#endif
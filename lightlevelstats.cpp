@@ -0,0 +1,149 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "lightlevelstats.h"
+#include "pqlookup.h"
+
+static int binForLightLevel(double nits){
+    
+    int bin = (int)(PQ10000_r(nits / 10000.0) * LIGHT_LEVEL_STATISTICS_BINS);
+    
+    if (bin < 0) { bin = 0; }
+    if (bin >= LIGHT_LEVEL_STATISTICS_BINS) { bin = LIGHT_LEVEL_STATISTICS_BINS - 1; }
+    
+    return bin;
+}
+
+static double percentileOfHistogram(const uint64_t * histogram, long long count, double maximum, double percentile){
+    
+    if (count <= 0) {
+        return 0.0;
+    }
+    
+    uint64_t threshold = (uint64_t)ceil(count * percentile);
+    uint64_t cumulative = 0;
+    
+    for (int i = 0; i < LIGHT_LEVEL_STATISTICS_BINS; i++) {
+        cumulative += histogram[i];
+        if (cumulative >= threshold) {
+            double binTop = 10000.0 * PQ10000_f((double)(i + 1) / LIGHT_LEVEL_STATISTICS_BINS);
+            return binTop < maximum ? binTop : maximum;
+        }
+    }
+    
+    return maximum;
+}
+
+void resetLightLevelStatistics(HDRLightLevelStatistics * statistics){
+    memset(statistics, 0, sizeof(HDRLightLevelStatistics));
+}
+
+void addFrameToLightLevelStatistics(HDRLightLevelStatistics * statistics, double maxFALL, double maxCLL, double maxPixelCLL){
+    
+    if (maxFALL < 0.0 || maxCLL < 0.0) {
+        statistics->failedFrameCount++;
+        return;
+    }
+    
+    statistics->frameCount++;
+    statistics->fallHistogram[binForLightLevel(maxFALL)]++;
+    statistics->cllHistogram[binForLightLevel(maxCLL)]++;
+    
+    if (maxFALL > statistics->maxFALL) { statistics->maxFALL = maxFALL; }
+    if (maxCLL > statistics->maxCLL) { statistics->maxCLL = maxCLL; }
+    if (maxPixelCLL > statistics->maxPixelCLL) { statistics->maxPixelCLL = maxPixelCLL; }
+}
+
+void mergeLightLevelStatistics(HDRLightLevelStatistics * statistics, const HDRLightLevelStatistics * other){
+    
+    statistics->frameCount += other->frameCount;
+    statistics->failedFrameCount += other->failedFrameCount;
+    
+    for (int i = 0; i < LIGHT_LEVEL_STATISTICS_BINS; i++) {
+        statistics->fallHistogram[i] += other->fallHistogram[i];
+        statistics->cllHistogram[i] += other->cllHistogram[i];
+    }
+    
+    if (other->maxFALL > statistics->maxFALL) { statistics->maxFALL = other->maxFALL; }
+    if (other->maxCLL > statistics->maxCLL) { statistics->maxCLL = other->maxCLL; }
+    if (other->maxPixelCLL > statistics->maxPixelCLL) { statistics->maxPixelCLL = other->maxPixelCLL; }
+}
+
+double lightLevelStatisticsFALLPercentile(const HDRLightLevelStatistics * statistics, double percentile){
+    return percentileOfHistogram(statistics->fallHistogram, statistics->frameCount, statistics->maxFALL, percentile);
+}
+
+double lightLevelStatisticsCLLPercentile(const HDRLightLevelStatistics * statistics, double percentile){
+    return percentileOfHistogram(statistics->cllHistogram, statistics->frameCount, statistics->maxCLL, percentile);
+}
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t bins;
+    int32_t shardIndex;
+    int32_t shardCount;
+    uint32_t reserved;
+} HDRLightLevelStatisticsHeader;
+
+static_assert(sizeof(HDRLightLevelStatisticsHeader) == 24, "statistics header layout");
+
+bool writeLightLevelStatistics(const char * path, const HDRLightLevelStatistics * statistics, int shardIndex, int shardCount){
+    
+    HDRLightLevelStatisticsHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LIGHT_LEVEL_STATISTICS_MAGIC, 4);
+    header.version = LIGHT_LEVEL_STATISTICS_VERSION;
+    header.bins = LIGHT_LEVEL_STATISTICS_BINS;
+    header.shardIndex = shardIndex;
+    header.shardCount = shardCount;
+    
+    //Written next to the file and renamed over it, so a merge never reads a half written shard
+    std::string temporaryPath = std::string(path) + ".tmp";
+    FILE * file = fopen(temporaryPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(statistics, sizeof(HDRLightLevelStatistics), 1, file) == 1;
+    
+    if (fclose(file) != 0 || !written || rename(temporaryPath.c_str(), path) != 0) {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    
+    return true;
+}
+
+bool readLightLevelStatistics(const char * path, HDRLightLevelStatistics * statistics, int * shardIndex, int * shardCount){
+    
+    FILE * file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    
+    HDRLightLevelStatisticsHeader header;
+    bool read = fread(&header, sizeof(header), 1, file) == 1 &&
+                memcmp(header.magic, LIGHT_LEVEL_STATISTICS_MAGIC, 4) == 0 &&
+                header.version == LIGHT_LEVEL_STATISTICS_VERSION &&
+                header.bins == LIGHT_LEVEL_STATISTICS_BINS &&
+                fread(statistics, sizeof(HDRLightLevelStatistics), 1, file) == 1;
+    
+    fclose(file);
+    
+    if (read) {
+        *shardIndex = header.shardIndex;
+        *shardCount = header.shardCount;
+    }
+    
+    return read;
+}
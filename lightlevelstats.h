@@ -0,0 +1,57 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef LIGHTLEVELSTATS
+#define LIGHTLEVELSTATS
+
+#include <stdint.h>
+
+/*
+ Reel level light level statistics gathered one frame at a time in constant memory. The maxFALL and
+ maxCLL of every frame go into a histogram of LIGHT_LEVEL_STATISTICS_BINS bins spaced evenly in the PQ
+ signal, so every bin is the same fraction of a visible step wide at any brightness. Percentiles are
+ read back as the top of the bin they fall in, capped at the exact maximum seen.
+
+ Statistics from separate runs or threads can be merged by adding their bins, which gives exactly
+ the statistics of one run over all of their frames. To merge the shards of a reel measured on several
+ machines, each writes its statistics to a file (host byte order, little endian on every platform this
+ builds on): a 24 byte header of "HDRS", version, bin count, shard index and shard count and a reserved
+ word, followed by the fields of HDRLightLevelStatistics in order.
+ */
+
+#define LIGHT_LEVEL_STATISTICS_BINS 4096
+
+#define LIGHT_LEVEL_STATISTICS_MAGIC "HDRS"
+#define LIGHT_LEVEL_STATISTICS_VERSION 1
+
+typedef struct {
+    long long frameCount;
+    long long failedFrameCount;
+    double maxFALL;                 //Exact maxima, cd/m2
+    double maxCLL;
+    double maxPixelCLL;             //Largest per frame pixel percentile of maxCLL
+    uint64_t fallHistogram[LIGHT_LEVEL_STATISTICS_BINS];
+    uint64_t cllHistogram[LIGHT_LEVEL_STATISTICS_BINS];
+} HDRLightLevelStatistics;
+
+void resetLightLevelStatistics(HDRLightLevelStatistics * statistics);
+
+//Values in cd/m2. Negative values mark a frame that couldn't be measured and are only counted.
+void addFrameToLightLevelStatistics(HDRLightLevelStatistics * statistics, double maxFALL, double maxCLL, double maxPixelCLL);
+
+void mergeLightLevelStatistics(HDRLightLevelStatistics * statistics, const HDRLightLevelStatistics * other);
+
+//The frame level maxFALL or maxCLL that the given fraction of frames don't exceed, cd/m2
+double lightLevelStatisticsFALLPercentile(const HDRLightLevelStatistics * statistics, double percentile);
+double lightLevelStatisticsCLLPercentile(const HDRLightLevelStatistics * statistics, double percentile);
+
+//Shards are numbered from 1 to shardCount, an unsharded run is shard 1 of 1. The file is replaced as a whole.
+bool writeLightLevelStatistics(const char * path, const HDRLightLevelStatistics * statistics, int shardIndex, int shardCount);
+
+//Returns false if the file can't be read or wasn't written by writeLightLevelStatistics
+bool readLightLevelStatistics(const char * path, HDRLightLevelStatistics * statistics, int * shardIndex, int * shardCount);
+
+#endif
@@ -0,0 +1,53 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef LIGHTLEVELTRAITS
+#define LIGHTLEVELTRAITS
+
+#include "pqlookup.h"
+
+/*
+ Compile time descriptions of the colour spaces and signal ranges the light level kernel is
+ specialized for. A primaries struct supplies the luminance coefficients, a range struct the code
+ values of black and white used to build its PQ lookup table.
+
+ To support new primaries add a struct here, a value to HDRColorSpace and a case to the switch in
+ lightLevelRowFunctionForISA. The kernels themselves don't change.
+ */
+
+typedef enum {
+    HDRColorSpaceBT2020 = 0,
+    HDRColorSpaceP3D65
+} HDRColorSpace;
+
+typedef enum {
+    HDRSignalRangeFull = 0,
+    HDRSignalRangeLegal
+} HDRSignalRange;
+
+struct HDRPrimariesBT2020 {
+    static constexpr float red = 0.2627f;
+    static constexpr float green = 0.6780f;
+    static constexpr float blue = 0.0593f;
+};
+
+struct HDRPrimariesP3D65 {
+    static constexpr float red = 0.228975f;
+    static constexpr float green = 0.691739f;
+    static constexpr float blue = 0.0792869f;
+};
+
+struct HDRRangeFull {
+    static constexpr int black = PQ_FULL_BLACK;
+    static constexpr int white = PQ_FULL_WHITE;
+};
+
+struct HDRRangeLegal {
+    static constexpr int black = PQ_LEGAL_BLACK;
+    static constexpr int white = PQ_LEGAL_WHITE;
+};
+
+#endif
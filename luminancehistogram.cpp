@@ -0,0 +1,64 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <math.h>
+#include <string.h>
+
+#include "luminancehistogram.h"
+
+static bool writeUInt32(FILE * sidecar, uint32_t value){
+    unsigned char bytes[4] = {(unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24)};
+    return fwrite(bytes, 1, sizeof(bytes), sidecar) == sizeof(bytes);
+}
+
+FILE * createLuminanceHistogramSidecar(const char * path){
+    
+    FILE * sidecar = fopen(path, "wb");
+    if (!sidecar) {
+        return NULL;
+    }
+    
+    bool written = fwrite(LUMINANCE_HISTOGRAM_MAGIC, 1, 4, sidecar) == 4 &&
+                   writeUInt32(sidecar, LUMINANCE_HISTOGRAM_VERSION) &&
+                   writeUInt32(sidecar, HDR_LUMINANCE_HISTOGRAM_BINS) &&
+                   writeUInt32(sidecar, (uint32_t)HDR_LUMINANCE_HISTOGRAM_BINS_PER_OCTAVE) &&
+                   writeUInt32(sidecar, (uint32_t)HDR_LUMINANCE_HISTOGRAM_LOWEST_OCTAVE);
+    
+    if (!written) {
+        fclose(sidecar);
+        return NULL;
+    }
+    
+    return sidecar;
+}
+
+bool writeLuminanceHistogramRecord(FILE * sidecar, const char * framePath, const uint32_t * histogram){
+    
+    uint32_t pathLength = (uint32_t)strlen(framePath);
+    
+    if (!writeUInt32(sidecar, pathLength) || fwrite(framePath, 1, pathLength, sidecar) != pathLength) {
+        return false;
+    }
+    
+    unsigned char counts[HDR_LUMINANCE_HISTOGRAM_BINS * 4];
+    for (int i = 0; i < HDR_LUMINANCE_HISTOGRAM_BINS; i++) {
+        counts[(i * 4)] = (unsigned char)histogram[i];
+        counts[(i * 4) + 1] = (unsigned char)(histogram[i] >> 8);
+        counts[(i * 4) + 2] = (unsigned char)(histogram[i] >> 16);
+        counts[(i * 4) + 3] = (unsigned char)(histogram[i] >> 24);
+    }
+    
+    return fwrite(counts, 1, sizeof(counts), sidecar) == sizeof(counts);
+}
+
+double luminanceHistogramBinLowerBound(int bin){
+    
+    //Within an octave the bins split the mantissa evenly
+    int octave = HDR_LUMINANCE_HISTOGRAM_LOWEST_OCTAVE + (bin / HDR_LUMINANCE_HISTOGRAM_BINS_PER_OCTAVE);
+    double mantissa = 1.0 + (double)(bin % HDR_LUMINANCE_HISTOGRAM_BINS_PER_OCTAVE) / HDR_LUMINANCE_HISTOGRAM_BINS_PER_OCTAVE;
+    
+    return 10000.0 * ldexp(mantissa, octave);
+}
@@ -0,0 +1,36 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef LUMINANCEHISTOGRAM
+#define LUMINANCEHISTOGRAM
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "luminancekernel.h"
+
+/*
+ Binary sidecar of per frame luminance histograms, one record per result line and in the same order.
+ All fields are little endian.
+
+ Header:    "HDRL", uint32 version, uint32 bins, int32 bins per octave, int32 lowest octave
+ Record:    uint32 path length, path bytes (no terminator), uint32 counts[bins]
+
+ A frame that couldn't be measured has a record with every count 0. Bin i starts at
+ luminanceHistogramBinLowerBound(i) cd/m2.
+ */
+
+#define LUMINANCE_HISTOGRAM_MAGIC "HDRL"
+#define LUMINANCE_HISTOGRAM_VERSION 1
+
+//Creates the sidecar and writes its header. NULL on failure.
+FILE * createLuminanceHistogramSidecar(const char * path);
+
+bool writeLuminanceHistogramRecord(FILE * sidecar, const char * framePath, const uint32_t * histogram);
+
+double luminanceHistogramBinLowerBound(int bin);
+
+#endif
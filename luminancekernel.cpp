@@ -0,0 +1,435 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <math.h>
+#include <string.h>
+
+#include "luminancekernel.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HDR_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+static inline float maxOfComponents(float a, float b){
+    //Same operand order as maxps so the scalar and SIMD kernels agree
+    return a > b ? a : b;
+}
+
+void resetLightLevelAccumulator(HDRLightLevelAccumulator * accumulator){
+    for (int i = 0; i < HDR_KERNEL_LANES; i++) {
+        accumulator->maxComponentSum[i] = 0.0;
+        accumulator->luminanceSum[i] = 0.0;
+    }
+    accumulator->maxComponent = 0.0f;
+    memset(accumulator->maxCodeHistogram, 0, sizeof(accumulator->maxCodeHistogram));
+    memset(accumulator->luminanceHistogram, 0, sizeof(accumulator->luminanceHistogram));
+}
+
+double lightLevelMaxComponentSum(const HDRLightLevelAccumulator * accumulator){
+    double sum = 0.0;
+    for (int i = 0; i < HDR_KERNEL_LANES; i++) {
+        sum += accumulator->maxComponentSum[i];
+    }
+    return sum;
+}
+
+double lightLevelLuminanceSum(const HDRLightLevelAccumulator * accumulator){
+    double sum = 0.0;
+    for (int i = 0; i < HDR_KERNEL_LANES; i++) {
+        sum += accumulator->luminanceSum[i];
+    }
+    return sum;
+}
+
+float lightLevelMaxComponentPercentile(const HDRLightLevelAccumulator * accumulator, const float * lookupTable, double percentile){
+    
+    uint64_t counts[HDR_KERNEL_HISTOGRAM_BINS];
+    uint64_t total = 0;
+    for (int i = 0; i < HDR_KERNEL_HISTOGRAM_BINS; i++) {
+        counts[i] = 0;
+        for (int copy = 0; copy < HDR_KERNEL_HISTOGRAM_COPIES; copy++) {
+            counts[i] += accumulator->maxCodeHistogram[copy][i];
+        }
+        total += counts[i];
+    }
+    
+    if (total == 0) {
+        return 0.0f;
+    }
+    
+    uint64_t threshold = (uint64_t)ceil(total * percentile);
+    uint64_t cumulative = 0;
+    int bin = HDR_KERNEL_HISTOGRAM_BINS - 1;
+    
+    for (int i = 0; i < HDR_KERNEL_HISTOGRAM_BINS; i++) {
+        cumulative += counts[i];
+        if (cumulative >= threshold) {
+            bin = i;
+            break;
+        }
+    }
+    
+    //The top of the bin can lie above every pixel actually in it
+    float value = lookupTable[((bin + 1) << HDR_KERNEL_HISTOGRAM_SHIFT) - 1];
+    return value < accumulator->maxComponent ? value : accumulator->maxComponent;
+}
+
+//Float bits shifted down to the exponent and the top mantissa bits count bins per octave from 2^-127
+#define LUMINANCE_HISTOGRAM_SHIFT 18
+#define LUMINANCE_HISTOGRAM_OFFSET ((127 + HDR_LUMINANCE_HISTOGRAM_LOWEST_OCTAVE) * HDR_LUMINANCE_HISTOGRAM_BINS_PER_OCTAVE)
+
+static inline int luminanceHistogramBin(float L){
+    uint32_t bits;
+    memcpy(&bits, &L, sizeof(bits));
+    int bin = (int)(bits >> LUMINANCE_HISTOGRAM_SHIFT) - LUMINANCE_HISTOGRAM_OFFSET;
+    if (bin < 0) { bin = 0; }
+    if (bin > HDR_LUMINANCE_HISTOGRAM_BINS - 1) { bin = HDR_LUMINANCE_HISTOGRAM_BINS - 1; }
+    return bin;
+}
+
+static inline uint16_t swapBytes(uint16_t code){
+    return (uint16_t)((code << 8) | (code >> 8));
+}
+
+template <class Primaries, bool LuminanceHistogram, bool ByteSwapped>
+static void reduceRowScalar(const uint16_t * row, int width, const float * lookupTable, HDRLightLevelAccumulator * accumulator){
+
+    float maxComponent = accumulator->maxComponent;
+
+    for (int x = 0; x < width; x++) {
+
+        const uint16_t * samples = row + (x * 3);
+        uint16_t pixel[3] = {samples[0], samples[1], samples[2]};
+        if (ByteSwapped) {
+            pixel[0] = swapBytes(pixel[0]);
+            pixel[1] = swapBytes(pixel[1]);
+            pixel[2] = swapBytes(pixel[2]);
+        }
+
+        float red = lookupTable[pixel[0]];
+        float green = lookupTable[pixel[1]];
+        float blue = lookupTable[pixel[2]];
+
+        float LMAX = maxOfComponents(maxOfComponents(red, green), blue);
+        float L = (Primaries::red * red) + (Primaries::green * green) + (Primaries::blue * blue);
+        
+        uint16_t maxCode = pixel[0] > pixel[1] ? pixel[0] : pixel[1];
+        maxCode = maxCode > pixel[2] ? maxCode : pixel[2];
+        accumulator->maxCodeHistogram[x & (HDR_KERNEL_HISTOGRAM_COPIES - 1)][maxCode >> HDR_KERNEL_HISTOGRAM_SHIFT]++;
+        
+        if (LuminanceHistogram) {
+            accumulator->luminanceHistogram[luminanceHistogramBin(L)]++;
+        }
+
+        int lane = x & (HDR_KERNEL_LANES - 1);
+        accumulator->maxComponentSum[lane] += LMAX;
+        accumulator->luminanceSum[lane] += L;
+
+        if (LMAX > maxComponent) {
+            maxComponent = LMAX;
+        }
+    }
+
+    accumulator->maxComponent = maxComponent;
+}
+
+#ifdef HDR_KERNEL_X86
+
+/*
+ Deinterleaving eight RGB16 pixels: the 24 code values are loaded as three 128 bit blocks and each
+ channel is gathered out of the blocks with one pshufb per block. A -128 (0x80) index zeroes the byte.
+ Byte swapped samples use the same masks with the two bytes of every word exchanged, so the swap
+ costs nothing.
+ */
+
+static const int8_t kDeinterleaveMasks[2][3][3][16] __attribute__((aligned(16))) = {{
+    //Red: words 0,3,6 | 9,12,15 | 18,21
+    {{ 0, 1, 6, 7, 12, 13, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, 2, 3, 8, 9, 14, 15, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 4, 5, 10, 11}},
+    //Green: words 1,4,7 | 10,13 | 16,19,22
+    {{ 2, 3, 8, 9, 14, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, 4, 5, 10, 11, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 0, 1, 6, 7, 12, 13}},
+    //Blue: words 2,5 | 8,11,14 | 17,20,23
+    {{ 4, 5, 10, 11, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, 0, 1, 6, 7, 12, 13, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 2, 3, 8, 9, 14, 15}}
+}, {
+    //Byte swapped
+    {{ 1, 0, 7, 6, 13, 12, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, 3, 2, 9, 8, 15, 14, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 5, 4, 11, 10}},
+    {{ 3, 2, 9, 8, 15, 14, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, 5, 4, 11, 10, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 1, 0, 7, 6, 13, 12}},
+    {{ 5, 4, 11, 10, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, 1, 0, 7, 6, 13, 12, -128, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 3, 2, 9, 8, 15, 14}}
+}};
+
+__attribute__((target("sse4.1")))
+static inline __m128i deinterleaveChannel(__m128i a, __m128i b, __m128i c, int channel, bool byteSwapped){
+    const __m128i * masks = (const __m128i *)kDeinterleaveMasks[byteSwapped ? 1 : 0][channel];
+    __m128i result = _mm_shuffle_epi8(a, _mm_load_si128(masks));
+    result = _mm_or_si128(result, _mm_shuffle_epi8(b, _mm_load_si128(masks + 1)));
+    result = _mm_or_si128(result, _mm_shuffle_epi8(c, _mm_load_si128(masks + 2)));
+    return result;
+}
+
+//Eight pixels starting on a multiple of 8, so pixel i lands in the same copy as in the scalar kernel
+__attribute__((target("sse4.1")))
+static inline void countMaxCodes(__m128i redCodes, __m128i greenCodes, __m128i blueCodes, uint32_t (*histogram)[HDR_KERNEL_HISTOGRAM_BINS]){
+    __m128i maxCodes = _mm_max_epu16(_mm_max_epu16(redCodes, greenCodes), blueCodes);
+    __m128i binVector = _mm_srli_epi16(maxCodes, HDR_KERNEL_HISTOGRAM_SHIFT);
+    uint16_t bins[8] __attribute__((aligned(16)));
+    _mm_store_si128((__m128i *)bins, binVector);
+    
+    //All eight in one bin, the common case in letterbox and flat areas, is a single increment
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(binVector, _mm_set1_epi16((short)bins[0]))) == 0xFFFF) {
+        histogram[0][bins[0]] += 8;
+        return;
+    }
+    
+    for (int i = 0; i < 8; i++) {
+        histogram[i & (HDR_KERNEL_HISTOGRAM_COPIES - 1)][bins[i]]++;
+    }
+}
+
+__attribute__((target("sse4.1")))
+static inline void countLuminance(__m128 L, uint32_t * histogram){
+    __m128i bins = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(L), LUMINANCE_HISTOGRAM_SHIFT), _mm_set1_epi32(LUMINANCE_HISTOGRAM_OFFSET));
+    bins = _mm_min_epi32(_mm_max_epi32(bins, _mm_setzero_si128()), _mm_set1_epi32(HDR_LUMINANCE_HISTOGRAM_BINS - 1));
+    int32_t indices[4] __attribute__((aligned(16)));
+    _mm_store_si128((__m128i *)indices, bins);
+    for (int i = 0; i < 4; i++) {
+        histogram[indices[i]]++;
+    }
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128 gatherFromLookupTable(const float * lookupTable, __m128i codes){
+    int32_t indices[4] __attribute__((aligned(16)));
+    _mm_store_si128((__m128i *)indices, codes);
+    return _mm_setr_ps(lookupTable[indices[0]], lookupTable[indices[1]], lookupTable[indices[2]], lookupTable[indices[3]]);
+}
+
+template <class Primaries, bool LuminanceHistogram, bool ByteSwapped>
+__attribute__((target("sse4.1")))
+static void reduceRowSSE41(const uint16_t * row, int width, const float * lookupTable, HDRLightLevelAccumulator * accumulator){
+
+    const __m128 kr = _mm_set1_ps(Primaries::red);
+    const __m128 kg = _mm_set1_ps(Primaries::green);
+    const __m128 kb = _mm_set1_ps(Primaries::blue);
+
+    __m128d maxSum[4];
+    __m128d luminanceSum[4];
+    for (int i = 0; i < 4; i++) {
+        maxSum[i] = _mm_loadu_pd(accumulator->maxComponentSum + (i * 2));
+        luminanceSum[i] = _mm_loadu_pd(accumulator->luminanceSum + (i * 2));
+    }
+    __m128 maxVector = _mm_set1_ps(accumulator->maxComponent);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+
+        const uint16_t * pixels = row + (x * 3);
+        __m128i a = _mm_loadu_si128((const __m128i *)pixels);
+        __m128i b = _mm_loadu_si128((const __m128i *)(pixels + 8));
+        __m128i c = _mm_loadu_si128((const __m128i *)(pixels + 16));
+
+        __m128i redCodes = deinterleaveChannel(a, b, c, 0, ByteSwapped);
+        __m128i greenCodes = deinterleaveChannel(a, b, c, 1, ByteSwapped);
+        __m128i blueCodes = deinterleaveChannel(a, b, c, 2, ByteSwapped);
+
+        countMaxCodes(redCodes, greenCodes, blueCodes, accumulator->maxCodeHistogram);
+
+        for (int half = 0; half < 2; half++) {
+
+            __m128 red = gatherFromLookupTable(lookupTable, _mm_cvtepu16_epi32(redCodes));
+            __m128 green = gatherFromLookupTable(lookupTable, _mm_cvtepu16_epi32(greenCodes));
+            __m128 blue = gatherFromLookupTable(lookupTable, _mm_cvtepu16_epi32(blueCodes));
+
+            __m128 LMAX = _mm_max_ps(_mm_max_ps(red, green), blue);
+            __m128 L = _mm_add_ps(_mm_add_ps(_mm_mul_ps(kr, red), _mm_mul_ps(kg, green)), _mm_mul_ps(kb, blue));
+
+            maxSum[half * 2] = _mm_add_pd(maxSum[half * 2], _mm_cvtps_pd(LMAX));
+            maxSum[half * 2 + 1] = _mm_add_pd(maxSum[half * 2 + 1], _mm_cvtps_pd(_mm_movehl_ps(LMAX, LMAX)));
+            luminanceSum[half * 2] = _mm_add_pd(luminanceSum[half * 2], _mm_cvtps_pd(L));
+            luminanceSum[half * 2 + 1] = _mm_add_pd(luminanceSum[half * 2 + 1], _mm_cvtps_pd(_mm_movehl_ps(L, L)));
+            maxVector = _mm_max_ps(maxVector, LMAX);
+
+            if (LuminanceHistogram) {
+                countLuminance(L, accumulator->luminanceHistogram);
+            }
+
+            redCodes = _mm_srli_si128(redCodes, 8);
+            greenCodes = _mm_srli_si128(greenCodes, 8);
+            blueCodes = _mm_srli_si128(blueCodes, 8);
+        }
+    }
+
+    for (int i = 0; i < 4; i++) {
+        _mm_storeu_pd(accumulator->maxComponentSum + (i * 2), maxSum[i]);
+        _mm_storeu_pd(accumulator->luminanceSum + (i * 2), luminanceSum[i]);
+    }
+
+    float maxValues[4];
+    _mm_storeu_ps(maxValues, maxVector);
+    for (int i = 0; i < 4; i++) {
+        accumulator->maxComponent = maxOfComponents(accumulator->maxComponent, maxValues[i]);
+    }
+
+    //x is a multiple of the lane count so the tail lands in the same lanes as it would in the scalar kernel
+    reduceRowScalar<Primaries, LuminanceHistogram, ByteSwapped>(row + (x * 3), width - x, lookupTable, accumulator);
+}
+
+__attribute__((target("avx2")))
+static inline void countLuminance8(__m256 L, uint32_t * histogram){
+    __m256i bins = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(L), LUMINANCE_HISTOGRAM_SHIFT), _mm256_set1_epi32(LUMINANCE_HISTOGRAM_OFFSET));
+    bins = _mm256_min_epi32(_mm256_max_epi32(bins, _mm256_setzero_si256()), _mm256_set1_epi32(HDR_LUMINANCE_HISTOGRAM_BINS - 1));
+    int32_t indices[8] __attribute__((aligned(32)));
+    _mm256_store_si256((__m256i *)indices, bins);
+    for (int i = 0; i < 8; i++) {
+        histogram[indices[i]]++;
+    }
+}
+
+template <class Primaries, bool LuminanceHistogram, bool ByteSwapped>
+__attribute__((target("avx2")))
+static void reduceRowAVX2(const uint16_t * row, int width, const float * lookupTable, HDRLightLevelAccumulator * accumulator){
+
+    const __m256 kr = _mm256_set1_ps(Primaries::red);
+    const __m256 kg = _mm256_set1_ps(Primaries::green);
+    const __m256 kb = _mm256_set1_ps(Primaries::blue);
+
+    __m256d maxSumLow = _mm256_loadu_pd(accumulator->maxComponentSum);
+    __m256d maxSumHigh = _mm256_loadu_pd(accumulator->maxComponentSum + 4);
+    __m256d luminanceSumLow = _mm256_loadu_pd(accumulator->luminanceSum);
+    __m256d luminanceSumHigh = _mm256_loadu_pd(accumulator->luminanceSum + 4);
+    __m256 maxVector = _mm256_set1_ps(accumulator->maxComponent);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+
+        const uint16_t * pixels = row + (x * 3);
+        __m128i a = _mm_loadu_si128((const __m128i *)pixels);
+        __m128i b = _mm_loadu_si128((const __m128i *)(pixels + 8));
+        __m128i c = _mm_loadu_si128((const __m128i *)(pixels + 16));
+
+        __m128i redCodes = deinterleaveChannel(a, b, c, 0, ByteSwapped);
+        __m128i greenCodes = deinterleaveChannel(a, b, c, 1, ByteSwapped);
+        __m128i blueCodes = deinterleaveChannel(a, b, c, 2, ByteSwapped);
+
+        countMaxCodes(redCodes, greenCodes, blueCodes, accumulator->maxCodeHistogram);
+
+        __m256 red = _mm256_i32gather_ps(lookupTable, _mm256_cvtepu16_epi32(redCodes), 4);
+        __m256 green = _mm256_i32gather_ps(lookupTable, _mm256_cvtepu16_epi32(greenCodes), 4);
+        __m256 blue = _mm256_i32gather_ps(lookupTable, _mm256_cvtepu16_epi32(blueCodes), 4);
+
+        __m256 LMAX = _mm256_max_ps(_mm256_max_ps(red, green), blue);
+        __m256 L = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(kr, red), _mm256_mul_ps(kg, green)), _mm256_mul_ps(kb, blue));
+
+        maxSumLow = _mm256_add_pd(maxSumLow, _mm256_cvtps_pd(_mm256_castps256_ps128(LMAX)));
+        maxSumHigh = _mm256_add_pd(maxSumHigh, _mm256_cvtps_pd(_mm256_extractf128_ps(LMAX, 1)));
+        luminanceSumLow = _mm256_add_pd(luminanceSumLow, _mm256_cvtps_pd(_mm256_castps256_ps128(L)));
+        luminanceSumHigh = _mm256_add_pd(luminanceSumHigh, _mm256_cvtps_pd(_mm256_extractf128_ps(L, 1)));
+        maxVector = _mm256_max_ps(maxVector, LMAX);
+
+        if (LuminanceHistogram) {
+            countLuminance8(L, accumulator->luminanceHistogram);
+        }
+    }
+
+    _mm256_storeu_pd(accumulator->maxComponentSum, maxSumLow);
+    _mm256_storeu_pd(accumulator->maxComponentSum + 4, maxSumHigh);
+    _mm256_storeu_pd(accumulator->luminanceSum, luminanceSumLow);
+    _mm256_storeu_pd(accumulator->luminanceSum + 4, luminanceSumHigh);
+
+    float maxValues[8];
+    _mm256_storeu_ps(maxValues, maxVector);
+    for (int i = 0; i < 8; i++) {
+        accumulator->maxComponent = maxOfComponents(accumulator->maxComponent, maxValues[i]);
+    }
+
+    reduceRowScalar<Primaries, LuminanceHistogram, ByteSwapped>(row + (x * 3), width - x, lookupTable, accumulator);
+}
+
+#endif
+
+template <class Primaries, bool LuminanceHistogram, bool ByteSwapped>
+static HDRLightLevelRowFunction rowFunctionForPrimaries(HDRKernelISA isa){
+
+    switch (isa) {
+        case HDRKernelScalar:
+            return reduceRowScalar<Primaries, LuminanceHistogram, ByteSwapped>;
+#ifdef HDR_KERNEL_X86
+        case HDRKernelSSE41:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.1") ? reduceRowSSE41<Primaries, LuminanceHistogram, ByteSwapped> : NULL;
+        case HDRKernelAVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? reduceRowAVX2<Primaries, LuminanceHistogram, ByteSwapped> : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+template <class Range>
+static const float * lookupTableForRange(){
+    return sharedPQLookupTable(Range::black, Range::white);
+}
+
+template <class Primaries>
+static HDRLightLevelRowFunction rowFunctionForVariant(HDRKernelISA isa, bool luminanceHistogram, bool byteSwapped){
+    if (byteSwapped) {
+        return luminanceHistogram ? rowFunctionForPrimaries<Primaries, true, true>(isa) : rowFunctionForPrimaries<Primaries, false, true>(isa);
+    }
+    return luminanceHistogram ? rowFunctionForPrimaries<Primaries, true, false>(isa) : rowFunctionForPrimaries<Primaries, false, false>(isa);
+}
+
+HDRLightLevelRowFunction lightLevelRowFunctionForISA(HDRKernelISA isa, HDRColorSpace colorSpace, bool luminanceHistogram, bool byteSwapped){
+
+    switch (colorSpace) {
+        case HDRColorSpaceBT2020:
+            return rowFunctionForVariant<HDRPrimariesBT2020>(isa, luminanceHistogram, byteSwapped);
+        case HDRColorSpaceP3D65:
+            return rowFunctionForVariant<HDRPrimariesP3D65>(isa, luminanceHistogram, byteSwapped);
+        default:
+            return NULL;
+    }
+}
+
+HDRKernelISA selectedLightLevelKernelISA(){
+
+    static const HDRKernelISA selected = lightLevelRowFunctionForISA(HDRKernelAVX2, HDRColorSpaceBT2020, false) ? HDRKernelAVX2 :
+                                         lightLevelRowFunctionForISA(HDRKernelSSE41, HDRColorSpaceBT2020, false) ? HDRKernelSSE41 : HDRKernelScalar;
+    return selected;
+}
+
+HDRLightLevelKernel selectLightLevelKernel(HDRColorSpace colorSpace, HDRSignalRange signalRange, bool luminanceHistogram){
+
+    HDRLightLevelKernel kernel;
+    kernel.reduceRow = lightLevelRowFunctionForISA(selectedLightLevelKernelISA(), colorSpace, luminanceHistogram);
+    kernel.reduceByteSwappedRow = lightLevelRowFunctionForISA(selectedLightLevelKernelISA(), colorSpace, luminanceHistogram, true);
+    kernel.lookupTable = signalRange == HDRSignalRangeLegal ? lookupTableForRange<HDRRangeLegal>() : lookupTableForRange<HDRRangeFull>();
+    kernel.sceneLinear = false;
+    return kernel;
+}
+
+const char * lightLevelKernelName(HDRKernelISA isa){
+
+    switch (isa) {
+        case HDRKernelSSE41:
+            return "SSE4.1";
+        case HDRKernelAVX2:
+            return "AVX2";
+        default:
+            return "Scalar";
+    }
+}
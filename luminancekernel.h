@@ -0,0 +1,98 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef LUMINANCEKERNEL
+#define LUMINANCEKERNEL
+
+#include <stdint.h>
+
+#include "lightleveltraits.h"
+
+/*
+ The light level kernel reduces one row of interleaved RGB16 pixels at a time. Every code value is
+ linearized through the PQ lookup table, the largest of the three channels is accumulated for maxFall
+ and tracked for maxCLL, and the weighted luminance sum is accumulated alongside it.
+
+ The sums are kept in HDR_KERNEL_LANES double lanes, pixel i of a row always landing in lane (i % 8),
+ and the lanes are folded in a fixed order at the end. The SIMD variants perform exactly the same
+ float and double operations per lane as the scalar one, so every variant returns identical results.
+ The lookup table must not contain NaN.
+
+ Every kernel is a template over the primaries in lightleveltraits.h, so the luminance coefficients are
+ constants and the loop has no colour space branch. The variant and the lookup table for the signal
+ range are picked once per job by selectLightLevelKernel.
+ */
+
+#define HDR_KERNEL_LANES 8
+
+/*
+ Every pixel also lands in a histogram of its largest code value, HDR_KERNEL_HISTOGRAM_BINS bins of
+ 64 codes each (10-bit PQ precision). Because the lookup table never decreases, the largest code of a
+ pixel always decodes to its LMAX, so the histogram gives pixel-level percentiles of maxCLL.
+
+ The counts are spread over HDR_KERNEL_HISTOGRAM_COPIES copies of the histogram, pixel i of a row going
+ to copy (i % HDR_KERNEL_HISTOGRAM_COPIES), so neighbouring pixels in the same bin don't wait on each
+ other's increment. Eight pixels in one bin, as in flat areas, are counted with a single add. The
+ copies are added up when the percentile is read.
+ */
+
+#define HDR_KERNEL_HISTOGRAM_BINS 1024
+#define HDR_KERNEL_HISTOGRAM_SHIFT 6
+#define HDR_KERNEL_HISTOGRAM_COPIES 4
+
+/*
+ Kernels selected with a luminance histogram also bin the normalized luminance of every pixel on a log
+ scale, HDR_LUMINANCE_HISTOGRAM_BINS_PER_OCTAVE bins per doubling from 2^HDR_LUMINANCE_HISTOGRAM_LOWEST_OCTAVE
+ up. The bin is read straight off the exponent and top mantissa bits of the float, so it costs no
+ transcendental per pixel. Anything darker lands in the first bin, anything brighter in the last.
+ */
+
+#define HDR_LUMINANCE_HISTOGRAM_BINS 1024
+#define HDR_LUMINANCE_HISTOGRAM_BINS_PER_OCTAVE 32
+#define HDR_LUMINANCE_HISTOGRAM_LOWEST_OCTAVE (-31)
+
+typedef struct {
+    double maxComponentSum[HDR_KERNEL_LANES];
+    double luminanceSum[HDR_KERNEL_LANES];
+    float maxComponent;
+    uint32_t maxCodeHistogram[HDR_KERNEL_HISTOGRAM_COPIES][HDR_KERNEL_HISTOGRAM_BINS];
+    uint32_t luminanceHistogram[HDR_LUMINANCE_HISTOGRAM_BINS];
+} HDRLightLevelAccumulator;
+
+typedef enum {
+    HDRKernelScalar = 0,
+    HDRKernelSSE41,
+    HDRKernelAVX2
+} HDRKernelISA;
+
+typedef void (*HDRLightLevelRowFunction)(const uint16_t * row, int width, const float * lookupTable, HDRLightLevelAccumulator * accumulator);
+
+typedef struct {
+    HDRLightLevelRowFunction reduceRow;
+    HDRLightLevelRowFunction reduceByteSwappedRow;     //For rows whose samples are in the other byte order
+    const float * lookupTable;
+    bool sceneLinear;                                  //Rows hold half float samples instead of PQ codes, see scenelinear.h
+} HDRLightLevelKernel;
+
+void resetLightLevelAccumulator(HDRLightLevelAccumulator * accumulator);
+double lightLevelMaxComponentSum(const HDRLightLevelAccumulator * accumulator);
+double lightLevelLuminanceSum(const HDRLightLevelAccumulator * accumulator);
+
+//Normalized LMAX below which the given fraction of pixels lie, rounded up to the top of its histogram bin but never above maxComponent
+float lightLevelMaxComponentPercentile(const HDRLightLevelAccumulator * accumulator, const float * lookupTable, double percentile);
+
+//Returns NULL if the ISA isn't supported by this build or by the running CPU. byteSwapped swaps the two bytes of every sample as it is loaded.
+HDRLightLevelRowFunction lightLevelRowFunctionForISA(HDRKernelISA isa, HDRColorSpace colorSpace, bool luminanceHistogram, bool byteSwapped = false);
+
+//The widest ISA the running CPU supports
+HDRKernelISA selectedLightLevelKernelISA();
+
+//Picks the row function and the shared lookup table for a job
+HDRLightLevelKernel selectLightLevelKernel(HDRColorSpace colorSpace, HDRSignalRange signalRange, bool luminanceHistogram);
+
+const char * lightLevelKernelName(HDRKernelISA isa);
+
+#endif
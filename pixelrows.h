@@ -0,0 +1,45 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef PIXELROWS
+#define PIXELROWS
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ A cropped region of an interleaved, row-major 16-bit frame. Pixel loops walk it one row at a time
+ through raw row pointers so that every access stays inside the scanline currently in cache.
+ */
+
+typedef struct {
+    const uint16_t * base;  //First component of the top left pixel of the region
+    size_t rowStride;       //Distance between rows in uint16_t elements
+    int width;
+    int height;
+    int channels;
+} HDRPixelRegion;
+
+inline HDRPixelRegion pixelRegionForFrame(const uint16_t * frame, int frameWidth, int channels, int x, int y, int width, int height){
+    size_t rowStride = (size_t)frameWidth * channels;
+    HDRPixelRegion region = {frame + (y * rowStride) + ((size_t)x * channels), rowStride, width, height, channels};
+    return region;
+}
+
+inline const uint16_t * pixelRegionRow(const HDRPixelRegion & region, int y){
+    return region.base + (y * region.rowStride);
+}
+
+//Calls function(row, y) for every row of the region from top to bottom
+template <typename RowFunction>
+inline void forEachPixelRow(const HDRPixelRegion & region, RowFunction function){
+    const uint16_t * row = region.base;
+    for (int y = 0; y < region.height; y++, row += region.rowStride) {
+        function(row, y);
+    }
+}
+
+#endif
@@ -0,0 +1,73 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <math.h>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "pqlookup.h"
+
+double PQ10000_f( double V){
+    //  10000 nits
+    //  1/gamma-ish, calculate V from Luma
+    //  decode L = (max(,0)/(c2-c3*V**(1/m)))**(1/n)
+    //  Lw, Lb not used since absolute Luma used for PQ
+    //  formula outputs normalized Luma from 0-1
+    
+    double L = 0.0;
+    L = pow(fmax(pow(V, 1.0/78.84375) - 0.8359375 ,0.0)/(18.8515625 - 18.6875 * pow(V, 1.0/78.84375)),1.0/0.1593017578);
+    return L;
+}
+
+double PQ10000_r( double L){
+    //  encode V = ((c1+c2*L**n)/(1+c3*L**n))**m
+    
+    double Ln = pow(fmax(L, 0.0), 0.1593017578);
+    double V = 0.0;
+    V = pow((0.8359375 + 18.8515625 * Ln)/(1.0 + 18.6875 * Ln), 78.84375);
+    return V;
+}
+
+void buildPQLookupTable(float black, float white, float * lookupTable){
+    
+    float range = white - black;
+    
+    for (int i = 0; i < PQ_LOOKUP_TABLE_SIZE; i++) {
+        //Codes below black would take pow() of a negative number, clamp them to 0 nits instead of NaN
+        float signal = (float)(i - black) / range;
+        lookupTable[i] = PQ10000_f(signal < 0.0 ? 0.0 : signal);
+    }
+}
+
+/*
+ Only a handful of (black, white) pairs are ever used in a run, so the tables live in a small map that
+ is filled under a lock. A table is never modified or freed once it has been published, so the pointer
+ handed out can be read from any thread without further synchronization.
+ */
+
+typedef std::pair<float, float> PQLookupTableKey;
+
+const float * sharedPQLookupTable(float black, float white){
+    
+    static std::mutex lookupTablesMutex;
+    static std::map<PQLookupTableKey, std::vector<float> *> lookupTables;
+    
+    std::lock_guard<std::mutex> lock(lookupTablesMutex);
+    
+    PQLookupTableKey key = std::make_pair(black, white);
+    std::map<PQLookupTableKey, std::vector<float> *>::iterator found = lookupTables.find(key);
+    if (found != lookupTables.end()) {
+        return found->second->data();
+    }
+    
+    std::vector<float> * lookupTable = new std::vector<float>(PQ_LOOKUP_TABLE_SIZE);
+    buildPQLookupTable(black, white, lookupTable->data());
+    lookupTables[key] = lookupTable;
+    
+    return lookupTable->data();
+}
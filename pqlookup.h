@@ -0,0 +1,29 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef PQLOOKUP
+#define PQLOOKUP
+
+#define PQ_LOOKUP_TABLE_SIZE 65536
+
+#define PQ_FULL_BLACK 0
+#define PQ_FULL_WHITE 65535
+
+#define PQ_LEGAL_BLACK 4096
+#define PQ_LEGAL_WHITE 60160
+
+double PQ10000_f( double V);
+
+//Inverse of PQ10000_f, normalized luminance to signal
+double PQ10000_r( double L);
+
+//Fills PQ_LOOKUP_TABLE_SIZE entries mapping 16-bit code values to normalized linear light
+void buildPQLookupTable(float black, float white, float * lookupTable);
+
+//Returns the table for (black, white), built once on first use and shared read-only by every thread for the life of the process
+const float * sharedPQLookupTable(float black, float white);
+
+#endif
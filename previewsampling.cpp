@@ -0,0 +1,63 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <math.h>
+#include <stdint.h>
+
+#include "previewsampling.h"
+
+int previewStripHeight(int rowsPerStrip){
+    
+    if (rowsPerStrip <= 0) {
+        rowsPerStrip = 1;
+    }
+    
+    return ((PREVIEW_MIN_STRIP_ROWS + rowsPerStrip - 1) / rowsPerStrip) * rowsPerStrip;
+}
+
+static int previewStride(int stripCount){
+    
+    int stride = stripCount / 2;
+    return stride < 1 ? 1 : (stride < PREVIEW_STRIP_STRIDE ? stride : PREVIEW_STRIP_STRIDE);
+}
+
+bool previewSamplesStrip(int strip, int stripCount){
+    
+    int stride = previewStride(stripCount);
+    int stratum = strip / stride;
+    int stratumWidth = stripCount - (stratum * stride) < stride ? stripCount - (stratum * stride) : stride;
+    
+    //A fixed scramble of the stratum number, so repeated previews of a frame agree
+    uint32_t offset = ((uint32_t)stratum * 2654435761u) >> 16;
+    
+    return strip - (stratum * stride) == (int)(offset % (uint32_t)stratumWidth);
+}
+
+void resetPreviewSample(HDRPreviewSample * sample, int stripCount){
+    sample->sampledStrips = 0;
+    sample->stripCount = stripCount;
+    sample->meanSum = 0.0;
+    sample->meanSquareSum = 0.0;
+}
+
+void addStripToPreviewSample(HDRPreviewSample * sample, double stripMean){
+    sample->sampledStrips++;
+    sample->meanSum += stripMean;
+    sample->meanSquareSum += stripMean * stripMean;
+}
+
+double previewStandardError(const HDRPreviewSample * sample){
+    
+    int n = sample->sampledStrips;
+    if (n < 2 || n >= sample->stripCount) {
+        return 0.0;
+    }
+    
+    double variance = (sample->meanSquareSum - ((sample->meanSum * sample->meanSum) / n)) / (n - 1);
+    double finitePopulation = 1.0 - ((double)n / sample->stripCount);
+    
+    return variance > 0.0 ? sqrt((variance / n) * finitePopulation) : 0.0;
+}
@@ -0,0 +1,44 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef PREVIEWSAMPLING
+#define PREVIEWSAMPLING
+
+/*
+ A preview measures a frame from a stratified sample of its strips. The active area is cut into strips
+ of whole file strips, the strips into strata of PREVIEW_STRIP_STRIDE, and one strip of every stratum
+ is read and reduced; the rest are never decoded. The strip picked moves from stratum to stratum so
+ that regular structure in the picture doesn't line up with the sample.
+
+ maxFALL is estimated from the sampled pixels, with a standard error from the spread of the strip
+ means, treating them as a random sample of the frame's strips (conservative for a stratified one).
+ maxCLL and the pixel percentile only see sampled pixels, so they are lower bounds: TIFF carries no
+ per strip maxima to track them exactly without decoding.
+ */
+
+#define PREVIEW_STRIP_STRIDE 16
+#define PREVIEW_MIN_STRIP_ROWS 8
+
+typedef struct {
+    int sampledStrips;
+    int stripCount;         //Of the whole area
+    double meanSum;         //Of the sampled strip means, normalized
+    double meanSquareSum;
+} HDRPreviewSample;
+
+//Rows per preview strip: the file's own strip height, in multiples of it up to at least PREVIEW_MIN_STRIP_ROWS
+int previewStripHeight(int rowsPerStrip);
+
+//Whether strip of stripCount is in the sample. At least two strips are sampled whenever there are two.
+bool previewSamplesStrip(int strip, int stripCount);
+
+void resetPreviewSample(HDRPreviewSample * sample, int stripCount);
+void addStripToPreviewSample(HDRPreviewSample * sample, double stripMean);
+
+//Standard error of the estimated mean, normalized, 0 when every strip was sampled
+double previewStandardError(const HDRPreviewSample * sample);
+
+#endif
@@ -0,0 +1,161 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <vector>
+
+#include "resultcache.h"
+#include "resultjournal.h"
+
+static_assert(sizeof(HDRResultCacheHeader) == 16, "cache header layout");
+static_assert(sizeof(HDRResultCacheRecord) == 56, "cache record layout");
+
+uint64_t resultCacheKey(const HDRFileIdentity & identity, uint64_t contentHash, const HDRResultCacheParameters & parameters){
+    
+    //Hashed as one block of fields so that no two different keys share their bytes
+    struct {
+        uint64_t version;
+        uint64_t contentHash;
+        HDRFileIdentity identity;
+        HDRResultCacheParameters parameters;
+    } key;
+    
+    memset(&key, 0, sizeof(key));
+    key.version = RESULT_CACHE_VERSION;
+    key.contentHash = contentHash;
+    key.identity.size = identity.size;
+    if (contentHash == 0) {
+        key.identity = identity;
+    }
+    key.parameters = parameters;
+    
+    return hashFilePath((const char *)&key, sizeof(key));
+}
+
+uint32_t resultParametersHash(const HDRResultCacheParameters & parameters){
+    
+    //Copied so that whatever padding a later field brings is zero
+    HDRResultCacheParameters key;
+    memset(&key, 0, sizeof(key));
+    key = parameters;
+    
+    return (uint32_t)hashFilePath((const char *)&key, sizeof(key));
+}
+
+HDRResultCache::HDRResultCache() : file(NULL) {
+}
+
+HDRResultCache::~HDRResultCache(){
+    close();
+}
+
+bool HDRResultCache::open(const char * path){
+    
+    close();
+    
+    file = fopen(path, "ab+");
+    if (!file) {
+        return false;
+    }
+    
+    struct stat status;
+    if (fstat(fileno(file), &status) != 0) {
+        close();
+        return false;
+    }
+    
+    HDRResultCacheHeader header;
+    
+    //Records of another layout can't be read, only measured again
+    if (status.st_size > 0 && pread(fileno(file), &header, sizeof(header), 0) == sizeof(header) &&
+        memcmp(header.magic, RESULT_CACHE_MAGIC, 4) == 0 && (header.version != RESULT_CACHE_VERSION || header.recordSize != sizeof(HDRResultCacheRecord))) {
+        if (ftruncate(fileno(file), 0) != 0) {
+            close();
+            return false;
+        }
+        status.st_size = 0;
+    }
+    
+    if (status.st_size == 0) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, RESULT_CACHE_MAGIC, 4);
+        header.version = RESULT_CACHE_VERSION;
+        header.recordSize = sizeof(HDRResultCacheRecord);
+        
+        if (fwrite(&header, sizeof(header), 1, file) != 1 || fflush(file) != 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+    
+    if (pread(fileno(file), &header, sizeof(header), 0) != sizeof(header) ||
+        memcmp(header.magic, RESULT_CACHE_MAGIC, 4) != 0 || header.recordSize != sizeof(HDRResultCacheRecord)) {
+        close();
+        return false;
+    }
+    
+    //Read in blocks, later entries replacing earlier ones for the same key
+    uint64_t wholeRecords = ((uint64_t)status.st_size - sizeof(header)) / sizeof(HDRResultCacheRecord);
+    std::vector<HDRResultCacheRecord> block(4096);
+    off_t offset = sizeof(header);
+    
+    records.reserve(wholeRecords);
+    
+    for (uint64_t read = 0; read < wholeRecords; ) {
+        
+        size_t count = wholeRecords - read < block.size() ? (size_t)(wholeRecords - read) : block.size();
+        size_t bytes = count * sizeof(HDRResultCacheRecord);
+        if (pread(fileno(file), block.data(), bytes, offset) != (ssize_t)bytes) {
+            close();
+            return false;
+        }
+        
+        for (size_t i = 0; i < count; i++) {
+            if (resultJournalChecksum(&block[i], offsetof(HDRResultCacheRecord, checksum)) == block[i].checksum) {
+                records[block[i].key] = block[i];
+            }
+        }
+        
+        read += count;
+        offset += bytes;
+    }
+    
+    //A record cut short by a crash would shift every record appended after it
+    if ((uint64_t)offset != (uint64_t)status.st_size && ftruncate(fileno(file), offset) != 0) {
+        close();
+        return false;
+    }
+    
+    return true;
+}
+
+void HDRResultCache::close(){
+    
+    if (file) {
+        fclose(file);
+        file = NULL;
+    }
+    records.clear();
+}
+
+const HDRResultCacheRecord * HDRResultCache::find(uint64_t key) const {
+    
+    std::unordered_map<uint64_t, HDRResultCacheRecord>::const_iterator found = records.find(key);
+    return found != records.end() ? &found->second : NULL;
+}
+
+bool HDRResultCache::add(HDRResultCacheRecord record){
+    
+    record.reserved = 0;
+    record.checksum = resultJournalChecksum(&record, offsetof(HDRResultCacheRecord, checksum));
+    
+    return fwrite(&record, sizeof(record), 1, file) == 1;
+}
@@ -0,0 +1,99 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef RESULTCACHE
+#define RESULTCACHE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <unordered_map>
+
+#include "fileidentity.h"
+
+/*
+ A persistent cache of frame results, kept across runs so a reel can be measured again at the cost of
+ only the frames that changed. A result is keyed by a 64-bit hash of the file and of everything the
+ result depends on (signal range or scene-linear scale, colour space, active rows), so the same file measured with other
+ settings is simply another entry.
+
+ The file is identified by its size, modification time and inode, or with verification by a hash of
+ its contents, in which case a copied or touched frame still hits and a frame rewritten in place
+ within the same second still misses.
+
+ The file is a 16 byte header followed by fixed size, CRC-32 checked records in the host byte order,
+ like the result journal. It is loaded whole when opened; entries added during a run are appended to
+ the file for the next run and are not looked up by this one, so lookups need no locking. A cache
+ written by another version of the tool is emptied when it is opened, its results are measured again.
+ */
+
+#define RESULT_CACHE_MAGIC "HDRC"
+#define RESULT_CACHE_VERSION 3
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+} HDRResultCacheHeader;
+
+typedef struct {
+    uint64_t key;               //resultCacheKey
+    double maxFALL;             //cd/m2
+    double maxCLL;
+    double maxPixelCLL;
+    double maxFALLStandardError;    //Of a --preview estimate, 0 for a full measurement
+    int32_t activeY;
+    int32_t activeHeight;
+    uint32_t checksum;          //CRC-32 of the bytes before it
+    uint32_t reserved;
+} HDRResultCacheRecord;
+
+//Everything besides the file a result depends on
+typedef struct {
+    int32_t signalRange;        //HDRSignalRange
+    int32_t colorSpace;         //HDRColorSpace
+    int32_t activeY;
+    int32_t activeHeight;
+    int32_t adaptiveArea;
+    int32_t preview;
+    float sceneLinearNits;      //Of a linear 1.0 with --scene-linear, 0 for PQ frames
+} HDRResultCacheParameters;
+
+//Hash of the parameters alone, kept with journaled results to tell whether a resumed run measures the same way
+uint32_t resultParametersHash(const HDRResultCacheParameters & parameters);
+
+//With a non zero contentHash the key is made from it and the size instead of the file's identity
+uint64_t resultCacheKey(const HDRFileIdentity & identity, uint64_t contentHash, const HDRResultCacheParameters & parameters);
+
+class HDRResultCache {
+public:
+    HDRResultCache();
+    ~HDRResultCache();
+    
+    //Loads the entries already in the file, creating it if needed, and opens it for appending
+    bool open(const char * path);
+    void close();
+    
+    //NULL on a miss
+    const HDRResultCacheRecord * find(uint64_t key) const;
+    
+    //Appends an entry for the next run, the checksum is filled in
+    bool add(HDRResultCacheRecord record);
+    
+    size_t size() const { return records.size(); }
+    bool isOpen() const { return file != NULL; }
+    
+private:
+    HDRResultCache(const HDRResultCache &);
+    HDRResultCache & operator=(const HDRResultCache &);
+    
+    FILE * file;
+    std::unordered_map<uint64_t, HDRResultCacheRecord> records;
+};
+
+#endif
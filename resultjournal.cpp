@@ -0,0 +1,304 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <string>
+
+#include "resultjournal.h"
+
+static_assert(sizeof(HDRResultJournalHeader) == 16, "journal header layout");
+static_assert(sizeof(HDRResultRecord) == 88, "journal record layout");
+
+typedef struct HDRChecksumTable {
+    uint32_t values[256];
+    
+    HDRChecksumTable(){
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++) {
+                value = (value & 1) ? (0xEDB88320 ^ (value >> 1)) : (value >> 1);
+            }
+            values[i] = value;
+        }
+    }
+} HDRChecksumTable;
+
+uint32_t resultJournalChecksum(const void * bytes, size_t length){
+    
+    //CRC-32 as used by zip and PNG, the table is built once on first use
+    static const HDRChecksumTable table;
+    
+    const unsigned char * data = (const unsigned char *)bytes;
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    
+    return crc ^ 0xFFFFFFFF;
+}
+
+static bool resultJournalHeaderIsValid(const HDRResultJournalHeader & header){
+    return memcmp(header.magic, RESULT_JOURNAL_MAGIC, 4) == 0 && header.version == RESULT_JOURNAL_VERSION && header.recordSize == sizeof(HDRResultRecord);
+}
+
+static bool sizeOfFile(FILE * file, uint64_t & size){
+    struct stat status;
+    if (fstat(fileno(file), &status) != 0) {
+        return false;
+    }
+    size = (uint64_t)status.st_size;
+    return true;
+}
+
+bool openResultJournal(HDRResultJournal * journal, const char * path){
+    
+    journal->unsyncedRecords = 0;
+    journal->lastSync = std::chrono::steady_clock::now();
+    journal->records = fopen(path, "ab+");
+    journal->paths = fopen((std::string(path) + RESULT_JOURNAL_PATHS_SUFFIX).c_str(), "ab");
+    
+    uint64_t recordsSize = 0;
+    if (!journal->records || !journal->paths || !sizeOfFile(journal->records, recordsSize) || !sizeOfFile(journal->paths, journal->pathsSize)) {
+        closeResultJournal(journal);
+        return false;
+    }
+    
+    if (recordsSize == 0) {
+        HDRResultJournalHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, RESULT_JOURNAL_MAGIC, 4);
+        header.version = RESULT_JOURNAL_VERSION;
+        header.recordSize = sizeof(HDRResultRecord);
+        
+        if (fwrite(&header, sizeof(header), 1, journal->records) != 1 || fflush(journal->records) != 0) {
+            closeResultJournal(journal);
+            return false;
+        }
+        return true;
+    }
+    
+    HDRResultJournalHeader header;
+    if (pread(fileno(journal->records), &header, sizeof(header), 0) != sizeof(header) || !resultJournalHeaderIsValid(header)) {
+        closeResultJournal(journal);
+        return false;
+    }
+    
+    //A record cut short by a crash would shift every record after it
+    uint64_t wholeRecords = (recordsSize - sizeof(header)) / sizeof(HDRResultRecord);
+    
+    //Records whose path never reached the disk before a crash would be read under the paths appended after them
+    while (wholeRecords > 0) {
+        HDRResultRecord record;
+        if (pread(fileno(journal->records), &record, sizeof(record), (off_t)(sizeof(header) + ((wholeRecords - 1) * sizeof(HDRResultRecord)))) != sizeof(record)) {
+            closeResultJournal(journal);
+            return false;
+        }
+        if (record.pathOffset + record.pathLength <= journal->pathsSize) {
+            break;
+        }
+        wholeRecords--;
+    }
+    
+    uint64_t expectedSize = sizeof(header) + (wholeRecords * sizeof(HDRResultRecord));
+    if (expectedSize != recordsSize && ftruncate(fileno(journal->records), (off_t)expectedSize) != 0) {
+        closeResultJournal(journal);
+        return false;
+    }
+    
+    return true;
+}
+
+bool appendResultJournalRecord(HDRResultJournal * journal, const char * framePath, HDRResultRecord record){
+    
+    uint32_t pathLength = (uint32_t)strlen(framePath);
+    if (fwrite(framePath, 1, pathLength, journal->paths) != pathLength) {
+        return false;
+    }
+    
+    record.pathOffset = journal->pathsSize;
+    record.pathHash = hashFilePath(framePath, pathLength);
+    record.pathLength = pathLength;
+    record.checksum = resultJournalChecksum(&record, offsetof(HDRResultRecord, checksum));
+    journal->pathsSize += pathLength;
+    
+    if (fwrite(&record, sizeof(record), 1, journal->records) != 1) {
+        return false;
+    }
+    
+    journal->unsyncedRecords++;
+    
+    if (journal->unsyncedRecords >= RESULT_JOURNAL_SYNC_RECORDS ||
+        std::chrono::steady_clock::now() - journal->lastSync >= std::chrono::seconds(RESULT_JOURNAL_SYNC_SECONDS)) {
+        return syncResultJournal(journal);
+    }
+    
+    return true;
+}
+
+bool syncResultJournal(HDRResultJournal * journal){
+    
+    journal->unsyncedRecords = 0;
+    journal->lastSync = std::chrono::steady_clock::now();
+    
+    //Paths first so a durable record never points past the durable end of the paths
+    return fflush(journal->paths) == 0 && fsync(fileno(journal->paths)) == 0 &&
+           fflush(journal->records) == 0 && fsync(fileno(journal->records)) == 0;
+}
+
+void closeResultJournal(HDRResultJournal * journal){
+    
+    if (journal->records && journal->paths) {
+        syncResultJournal(journal);
+    }
+    
+    if (journal->records) {
+        fclose(journal->records);
+    }
+    if (journal->paths) {
+        fclose(journal->paths);
+    }
+    
+    journal->records = NULL;
+    journal->paths = NULL;
+}
+
+static void * mapFile(const char * path, size_t & size){
+    
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return NULL;
+    }
+    
+    struct stat status;
+    void * mapping = NULL;
+    
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+        size = (size_t)status.st_size;
+        mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, file, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = NULL;
+        }
+    }
+    
+    close(file);
+    return mapping;
+}
+
+bool mapResultJournal(HDRResultJournalView * view, const char * path){
+    
+    memset(view, 0, sizeof(HDRResultJournalView));
+    
+    view->recordsMapping = mapFile(path, view->recordsMappingSize);
+    if (!view->recordsMapping || view->recordsMappingSize < sizeof(HDRResultJournalHeader)) {
+        unmapResultJournal(view);
+        return false;
+    }
+    
+    const HDRResultJournalHeader * header = (const HDRResultJournalHeader *)view->recordsMapping;
+    if (!resultJournalHeaderIsValid(*header)) {
+        unmapResultJournal(view);
+        return false;
+    }
+    
+    view->records = (const HDRResultRecord *)((const char *)view->recordsMapping + sizeof(HDRResultJournalHeader));
+    view->recordCount = (view->recordsMappingSize - sizeof(HDRResultJournalHeader)) / sizeof(HDRResultRecord);
+    
+    //An empty .paths file can't be mapped, every record then fails validation
+    view->pathsMapping = mapFile((std::string(path) + RESULT_JOURNAL_PATHS_SUFFIX).c_str(), view->pathsMappingSize);
+    view->paths = (const char *)view->pathsMapping;
+    view->pathsSize = view->pathsMapping ? view->pathsMappingSize : 0;
+    
+    madvise(view->recordsMapping, view->recordsMappingSize, MADV_SEQUENTIAL);
+    
+    return true;
+}
+
+void unmapResultJournal(HDRResultJournalView * view){
+    
+    if (view->recordsMapping) {
+        munmap(view->recordsMapping, view->recordsMappingSize);
+    }
+    if (view->pathsMapping) {
+        munmap(view->pathsMapping, view->pathsMappingSize);
+    }
+    
+    memset(view, 0, sizeof(HDRResultJournalView));
+}
+
+bool resultJournalRecordIsValid(const HDRResultJournalView * view, size_t index){
+    
+    const HDRResultRecord & record = view->records[index];
+    
+    if (resultJournalChecksum(&record, offsetof(HDRResultRecord, checksum)) != record.checksum) {
+        return false;
+    }
+    
+    if (record.pathOffset + record.pathLength > view->pathsSize) {
+        return false;
+    }
+    
+    //A path lost in a crash and written over by a later frame's doesn't hash the same
+    return hashFilePath(view->paths + record.pathOffset, record.pathLength) == record.pathHash;
+}
+
+const char * resultJournalRecordPath(const HDRResultJournalView * view, size_t index){
+    return view->paths + view->records[index].pathOffset;
+}
+
+HDRResultJournalIndex::HDRResultJournalIndex(const HDRResultJournalView * view) : view(view), count(0) {
+    
+    size_t capacity = 16;
+    while (capacity < view->recordCount * 2) {
+        capacity *= 2;
+    }
+    
+    slots.assign(capacity, -1);
+    mask = capacity - 1;
+    
+    //Later records replace earlier ones for the same path, a file measured again after it changed
+    for (size_t i = 0; i < view->recordCount; i++) {
+        
+        if (!resultJournalRecordIsValid(view, i)) {
+            continue;
+        }
+        
+        const HDRResultRecord & record = view->records[i];
+        size_t slot = record.pathHash & mask;
+        
+        while (slots[slot] != -1) {
+            const HDRResultRecord & existing = view->records[slots[slot]];
+            if (existing.pathHash == record.pathHash && existing.pathLength == record.pathLength &&
+                memcmp(resultJournalRecordPath(view, slots[slot]), resultJournalRecordPath(view, i), record.pathLength) == 0) {
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        
+        if (slots[slot] == -1) {
+            count++;
+        }
+        slots[slot] = (long long)i;
+    }
+}
+
+long long HDRResultJournalIndex::find(const char * path, size_t length) const {
+    
+    uint64_t hash = hashFilePath(path, length);
+    
+    for (size_t slot = hash & mask; slots[slot] != -1; slot = (slot + 1) & mask) {
+        const HDRResultRecord & record = view->records[slots[slot]];
+        if (record.pathHash == hash && record.pathLength == length && memcmp(resultJournalRecordPath(view, slots[slot]), path, length) == 0) {
+            return slots[slot];
+        }
+    }
+    
+    return -1;
+}
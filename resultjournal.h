@@ -0,0 +1,138 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef RESULTJOURNAL
+#define RESULTJOURNAL
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+#include "fileidentity.h"
+
+/*
+ Append-only binary results. A journal is two files: <path> holds a 16 byte header followed by one
+ fixed size record per frame, <path>.paths holds the frame paths back to back, each record pointing at
+ its own. Both are written in the host byte order (little endian on every platform this builds on).
+
+ Every record carries a CRC-32 of its other bytes, so a record torn by a crash or damaged on disk is
+ detected and skipped rather than read as a result. Opening a journal for append drops a partial
+ record left at the end of the file, and the records at its end whose paths never reached the .paths
+ file.
+
+ Because records are fixed size the journal is read by mapping it into memory: record i is at a known
+ offset and loading millions of frames costs nothing up front.
+
+ Records are flushed and fsync'ed in batches of RESULT_JOURNAL_SYNC_RECORDS, or after
+ RESULT_JOURNAL_SYNC_SECONDS, the paths before the records, so a record that survives a crash always
+ has its path. The journal then doubles as the resume log: each record holds the hash of its full
+ path and the identity of the file it measured, from which HDRResultJournalIndex looks frames up, and
+ a hash of the settings it was measured with, so a run with other settings measures the frame again.
+ */
+
+#define RESULT_JOURNAL_MAGIC "HDRB"
+#define RESULT_JOURNAL_VERSION 2
+#define RESULT_JOURNAL_PATHS_SUFFIX ".paths"
+
+//Set on results estimated by --preview, which a full run doesn't resume from
+#define RESULT_JOURNAL_FLAG_PREVIEW 1
+
+#define RESULT_JOURNAL_SYNC_RECORDS 256
+#define RESULT_JOURNAL_SYNC_SECONDS 2
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+} HDRResultJournalHeader;
+
+typedef struct {
+    uint64_t pathOffset;        //Into the .paths file
+    uint64_t pathHash;          //hashFilePath of the full path
+    HDRFileIdentity identity;   //Of the file when it was measured
+    uint32_t pathLength;
+    uint32_t flags;             //RESULT_JOURNAL_FLAG_*
+    int32_t activeY;
+    int32_t activeHeight;
+    double maxFALL;             //cd/m2, negative when the frame couldn't be measured as in the text results
+    double maxCLL;
+    double maxPixelCLL;
+    uint32_t parametersHash;    //Of the settings it was measured with, see resultParametersHash, 0 before they were recorded
+    uint32_t checksum;          //CRC-32 of every byte before it
+} HDRResultRecord;
+
+typedef struct {
+    FILE * records;
+    FILE * paths;
+    uint64_t pathsSize;
+    int unsyncedRecords;
+    std::chrono::steady_clock::time_point lastSync;
+} HDRResultJournal;
+
+//Opens for append, creating the files and writing the header if needed. Returns false on failure.
+bool openResultJournal(HDRResultJournal * journal, const char * path);
+
+//Fills in pathOffset, pathHash, pathLength and checksum from framePath and syncs when a batch is due
+bool appendResultJournalRecord(HDRResultJournal * journal, const char * framePath, HDRResultRecord record);
+
+//Makes every record appended so far durable
+bool syncResultJournal(HDRResultJournal * journal);
+
+//Syncs and closes. Safe to call on a journal that failed to open.
+void closeResultJournal(HDRResultJournal * journal);
+
+typedef struct {
+    const HDRResultRecord * records;
+    size_t recordCount;
+    const char * paths;
+    size_t pathsSize;
+    void * recordsMapping;
+    size_t recordsMappingSize;
+    void * pathsMapping;
+    size_t pathsMappingSize;
+} HDRResultJournalView;
+
+//Maps a journal read-only. Returns false if it can't be mapped or isn't a journal.
+bool mapResultJournal(HDRResultJournalView * view, const char * path);
+
+void unmapResultJournal(HDRResultJournalView * view);
+
+//False if the record's checksum doesn't match or its path isn't in the .paths file as it was written
+bool resultJournalRecordIsValid(const HDRResultJournalView * view, size_t index);
+
+//The record's path, not NUL terminated; see pathLength
+const char * resultJournalRecordPath(const HDRResultJournalView * view, size_t index);
+
+uint32_t resultJournalChecksum(const void * bytes, size_t length);
+
+/*
+ Finds the latest valid record for a full path. The table is open addressed on the path hashes
+ stored in the records. Building it reads and hashes the path of every record, to leave out those
+ whose path was lost in a crash, so it costs a pass over the .paths file. It refers into the view,
+ which must stay mapped while it is used.
+ */
+
+class HDRResultJournalIndex {
+public:
+    explicit HDRResultJournalIndex(const HDRResultJournalView * view);
+
+    //Index of the record, -1 if the path isn't in the journal
+    long long find(const char * path, size_t length) const;
+
+    size_t size() const { return count; }
+
+private:
+    const HDRResultJournalView * view;
+    std::vector<long long> slots;
+    size_t mask;
+    size_t count;
+};
+
+#endif
@@ -0,0 +1,318 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <string.h>
+#include <unistd.h>
+
+#include "runmetrics.h"
+
+const char * runStageName(HDRRunStage stage){
+    
+    switch (stage) {
+        case HDRRunStageOpen: return "open";
+        case HDRRunStageDecode: return "decode";
+        case HDRRunStageCompute: return "compute";
+        case HDRRunStageWrite: return "write";
+        default: return "unknown";
+    }
+}
+
+static void addStageLatency(HDRStageLatency * latency, uint64_t nanoseconds){
+    
+    int bucket = 0;
+    for (uint64_t microseconds = nanoseconds / 1000; microseconds > 1 && bucket < RUN_METRICS_BUCKETS - 1; microseconds >>= 1) {
+        bucket++;
+    }
+    
+    latency->count++;
+    latency->totalNanoseconds += nanoseconds;
+    latency->buckets[bucket]++;
+    if (nanoseconds > latency->maxNanoseconds) {
+        latency->maxNanoseconds = nanoseconds;
+    }
+}
+
+//Upper edge of bucket i in milliseconds
+static double bucketEdgeMilliseconds(int bucket){
+    return (double)(2ULL << bucket) / 1000.0;
+}
+
+double stageLatencyPercentile(const HDRStageLatency * latency, double percentile){
+    
+    if (latency->count == 0) {
+        return 0.0;
+    }
+    
+    long long target = (long long)(percentile * latency->count + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+    
+    //No percentile is past the slowest frame, whatever its bucket's edge
+    double slowest = latency->maxNanoseconds / 1.0e6;
+    
+    long long seen = 0;
+    for (int i = 0; i < RUN_METRICS_BUCKETS; i++) {
+        seen += latency->buckets[i];
+        if (seen >= target) {
+            return bucketEdgeMilliseconds(i) < slowest ? bucketEdgeMilliseconds(i) : slowest;
+        }
+    }
+    
+    return slowest;
+}
+
+static double framesPerSecond(const HDRRunMetricsSnapshot * snapshot){
+    return snapshot->elapsedSeconds > 0.0 ? snapshot->framesWritten / snapshot->elapsedSeconds : 0.0;
+}
+
+static double megabytesPerSecond(const HDRRunMetricsSnapshot * snapshot){
+    return snapshot->elapsedSeconds > 0.0 ? snapshot->bytesRead / (snapshot->elapsedSeconds * 1.0e6) : 0.0;
+}
+
+bool writeRunMetricsJSON(FILE * file, const HDRRunMetricsSnapshot * s){
+    
+    fprintf(file, "{\n");
+    fprintf(file, "  \"elapsed_seconds\": %.3f,\n", s->elapsedSeconds);
+    fprintf(file, "  \"frames_written\": %lld,\n", s->framesWritten);
+    fprintf(file, "  \"frames_measured\": %lld,\n", s->framesMeasured);
+    fprintf(file, "  \"frames_stored\": %lld,\n", s->framesStored);
+    fprintf(file, "  \"frames_failed\": %lld,\n", s->framesFailed);
+    fprintf(file, "  \"frames_expected\": %lld,\n", s->framesExpected);
+    fprintf(file, "  \"bytes_read\": %llu,\n", (unsigned long long)s->bytesRead);
+    fprintf(file, "  \"frames_per_second\": %.3f,\n", framesPerSecond(s));
+    fprintf(file, "  \"megabytes_per_second\": %.3f,\n", megabytesPerSecond(s));
+    fprintf(file, "  \"queues\": {\"in_flight\": %lld, \"awaiting_compute\": %lld, \"awaiting_write\": %lld},\n",
+            s->framesPulled - s->framesWritten, s->framesLoaded > 0 ? s->framesLoaded - s->framesComputed : 0, s->framesComputed - s->framesWritten);
+    fprintf(file, "  \"stages\": {\n");
+    
+    for (int i = 0; i < HDRRunStageCount; i++) {
+        const HDRStageLatency * latency = &s->stages[i];
+        fprintf(file, "    \"%s\": {\"count\": %lld, \"total_seconds\": %.6f, \"mean_ms\": %.3f, \"p50_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f}%s\n",
+                runStageName((HDRRunStage)i), latency->count, latency->totalNanoseconds / 1.0e9,
+                latency->count > 0 ? latency->totalNanoseconds / (latency->count * 1.0e6) : 0.0,
+                stageLatencyPercentile(latency, 0.5), stageLatencyPercentile(latency, 0.99), latency->maxNanoseconds / 1.0e6,
+                i + 1 < HDRRunStageCount ? "," : "");
+    }
+    
+    fprintf(file, "  }\n}\n");
+    
+    return ferror(file) == 0;
+}
+
+bool writeRunMetricsPrometheus(FILE * file, const HDRRunMetricsSnapshot * s){
+    
+    fprintf(file, "# HELP hdrgenerator_frames_total Frames written, by where their result came from.\n");
+    fprintf(file, "# TYPE hdrgenerator_frames_total counter\n");
+    fprintf(file, "hdrgenerator_frames_total{result=\"measured\"} %lld\n", s->framesMeasured);
+    fprintf(file, "hdrgenerator_frames_total{result=\"stored\"} %lld\n", s->framesStored);
+    fprintf(file, "hdrgenerator_frames_total{result=\"failed\"} %lld\n", s->framesFailed);
+    fprintf(file, "# HELP hdrgenerator_frames_expected Frames the run will write, 0 when not known.\n");
+    fprintf(file, "# TYPE hdrgenerator_frames_expected gauge\n");
+    fprintf(file, "hdrgenerator_frames_expected %lld\n", s->framesExpected);
+    fprintf(file, "# HELP hdrgenerator_read_bytes_total Size of the frames measured.\n");
+    fprintf(file, "# TYPE hdrgenerator_read_bytes_total counter\n");
+    fprintf(file, "hdrgenerator_read_bytes_total %llu\n", (unsigned long long)s->bytesRead);
+    fprintf(file, "# HELP hdrgenerator_elapsed_seconds Time since the frames started.\n");
+    fprintf(file, "# TYPE hdrgenerator_elapsed_seconds gauge\n");
+    fprintf(file, "hdrgenerator_elapsed_seconds %.3f\n", s->elapsedSeconds);
+    fprintf(file, "# HELP hdrgenerator_queue_frames Frames waiting between stages.\n");
+    fprintf(file, "# TYPE hdrgenerator_queue_frames gauge\n");
+    fprintf(file, "hdrgenerator_queue_frames{queue=\"in_flight\"} %lld\n", s->framesPulled - s->framesWritten);
+    fprintf(file, "hdrgenerator_queue_frames{queue=\"awaiting_compute\"} %lld\n", s->framesLoaded > 0 ? s->framesLoaded - s->framesComputed : 0);
+    fprintf(file, "hdrgenerator_queue_frames{queue=\"awaiting_write\"} %lld\n", s->framesComputed - s->framesWritten);
+    fprintf(file, "# HELP hdrgenerator_stage_seconds Time per frame in each stage.\n");
+    fprintf(file, "# TYPE hdrgenerator_stage_seconds histogram\n");
+    
+    for (int i = 0; i < HDRRunStageCount; i++) {
+        const HDRStageLatency * latency = &s->stages[i];
+        const char * name = runStageName((HDRRunStage)i);
+        long long cumulative = 0;
+        for (int b = 0; b < RUN_METRICS_BUCKETS; b++) {
+            cumulative += latency->buckets[b];
+            fprintf(file, "hdrgenerator_stage_seconds_bucket{stage=\"%s\",le=\"%g\"} %lld\n", name, bucketEdgeMilliseconds(b) / 1000.0, cumulative);
+        }
+        fprintf(file, "hdrgenerator_stage_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %lld\n", name, latency->count);
+        fprintf(file, "hdrgenerator_stage_seconds_sum{stage=\"%s\"} %.6f\n", name, latency->totalNanoseconds / 1.0e9);
+        fprintf(file, "hdrgenerator_stage_seconds_count{stage=\"%s\"} %lld\n", name, latency->count);
+    }
+    
+    return ferror(file) == 0;
+}
+
+HDRRunMetrics::HDRRunMetrics() : start(std::chrono::steady_clock::now()), pulled(0), loaded(0), computed(0), reporting(false), progress(false) {
+    memset(&totals, 0, sizeof(totals));
+}
+
+HDRRunMetrics::~HDRRunMetrics(){
+    stopReporting();
+}
+
+void HDRRunMetrics::setExpectedFrames(long long frames){
+    std::unique_lock<std::mutex> lock(mutex);
+    totals.framesExpected = frames;
+}
+
+void HDRRunMetrics::addFrame(const HDRFrameTimings & timings, uint64_t writeNanoseconds, uint64_t bytes, bool stored, bool failed){
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    
+    totals.framesWritten++;
+    if (stored) {
+        totals.framesStored++;
+    }
+    if (failed) {
+        totals.framesFailed++;
+    }
+    
+    if (timings.measured) {
+        totals.framesMeasured++;
+        totals.bytesRead += bytes;
+        addStageLatency(&totals.stages[HDRRunStageOpen], timings.openNanoseconds);
+        addStageLatency(&totals.stages[HDRRunStageDecode], timings.decodeNanoseconds);
+        addStageLatency(&totals.stages[HDRRunStageCompute], timings.computeNanoseconds);
+    }
+    
+    addStageLatency(&totals.stages[HDRRunStageWrite], writeNanoseconds);
+}
+
+HDRRunMetricsSnapshot HDRRunMetrics::snapshot(){
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    
+    HDRRunMetricsSnapshot snapshot = totals;
+    snapshot.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    //Later stages are read first, so a frame moving on meanwhile can't make a queue depth negative
+    snapshot.framesComputed = computed;
+    snapshot.framesLoaded = loaded;
+    snapshot.framesPulled = pulled;
+    
+    return snapshot;
+}
+
+bool HDRRunMetrics::startReporting(bool showProgress, const char * path){
+    
+    std::unique_lock<std::mutex> lock(reporterMutex);
+    if (reporting) {
+        return false;
+    }
+    
+    reporting = true;
+    progress = showProgress;
+    snapshotPath = path ? path : "";
+    reporter = std::thread([this](){ report(); });
+    
+    return true;
+}
+
+bool HDRRunMetrics::stopReporting(){
+    
+    {
+        std::unique_lock<std::mutex> lock(reporterMutex);
+        if (!reporting) {
+            return true;
+        }
+        reporting = false;
+        reporterWake.notify_all();
+    }
+    
+    reporter.join();
+    
+    if (progress && isatty(fileno(stderr))) {
+        fprintf(stderr, "\r\033[K");
+    }
+    
+    return snapshotPath.empty() || writeSnapshot();
+}
+
+static void formatDuration(double seconds, char * text, size_t size){
+    long long whole = (long long)seconds;
+    snprintf(text, size, "%lld:%02lld:%02lld", whole / 3600, (whole / 60) % 60, whole % 60);
+}
+
+void HDRRunMetrics::report(){
+    
+    bool terminal = isatty(fileno(stderr));
+    std::chrono::seconds progressInterval(terminal ? 1 : RUN_METRICS_LOG_SECONDS);
+    std::chrono::seconds snapshotInterval(RUN_METRICS_SNAPSHOT_SECONDS);
+    
+    std::chrono::steady_clock::time_point nextProgress = std::chrono::steady_clock::now() + progressInterval;
+    std::chrono::steady_clock::time_point nextSnapshot = std::chrono::steady_clock::now() + snapshotInterval;
+    HDRRunMetricsSnapshot previous = snapshot();
+    
+    std::unique_lock<std::mutex> lock(reporterMutex);
+    
+    while (reporting) {
+        
+        std::chrono::steady_clock::time_point wake = nextSnapshot;
+        if (progress && nextProgress < wake) {
+            wake = nextProgress;
+        }
+        
+        reporterWake.wait_until(lock, wake);
+        if (!reporting) {
+            break;
+        }
+        
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        
+        if (progress && now >= nextProgress) {
+            
+            HDRRunMetricsSnapshot current = snapshot();
+            
+            //Rates over the last interval, the ETA from the whole run so far
+            double interval = current.elapsedSeconds - previous.elapsedSeconds;
+            double recentFrames = interval > 0.0 ? (current.framesWritten - previous.framesWritten) / interval : 0.0;
+            double recentBytes = interval > 0.0 ? (current.bytesRead - previous.bytesRead) / (interval * 1.0e6) : 0.0;
+            
+            char eta[32] = "--";
+            double rate = framesPerSecond(&current);
+            if (current.framesExpected > 0 && rate > 0.0) {
+                formatDuration((current.framesExpected - current.framesWritten) / rate, eta, sizeof(eta));
+            }
+            
+            char line[256];
+            snprintf(line, sizeof(line), "%lld/%lld frames  %.1f fps  %.0f MB/s  in flight %lld, awaiting compute %lld, awaiting write %lld  ETA %s",
+                     current.framesWritten, current.framesExpected, recentFrames, recentBytes, current.framesPulled - current.framesWritten,
+                     current.framesLoaded > 0 ? current.framesLoaded - current.framesComputed : 0, current.framesComputed - current.framesWritten, eta);
+            
+            fprintf(stderr, terminal ? "\r%s\033[K" : "%s\n", line);
+            fflush(stderr);
+            
+            previous = current;
+            nextProgress = now + progressInterval;
+        }
+        
+        if (now >= nextSnapshot) {
+            if (!snapshotPath.empty()) {
+                writeSnapshot();
+            }
+            nextSnapshot = now + snapshotInterval;
+        }
+    }
+}
+
+bool HDRRunMetrics::writeSnapshot(){
+    
+    HDRRunMetricsSnapshot current = snapshot();
+    
+    std::string temporaryPath = snapshotPath + ".tmp";
+    FILE * file = fopen(temporaryPath.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    
+    bool prometheus = snapshotPath.size() >= 5 && snapshotPath.compare(snapshotPath.size() - 5, 5, ".prom") == 0;
+    bool written = prometheus ? writeRunMetricsPrometheus(file, &current) : writeRunMetricsJSON(file, &current);
+    
+    if (fclose(file) != 0 || !written || rename(temporaryPath.c_str(), snapshotPath.c_str()) != 0) {
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    
+    return true;
+}
@@ -0,0 +1,121 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef RUNMETRICS
+#define RUNMETRICS
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "stagetiming.h"
+
+/*
+ Throughput and per stage latencies of a run, to tell whether it is bound by storage, decoding or the
+ kernel without a profiler. The calling thread adds every frame as it writes the result; the workers
+ only bump the atomic stage counters, from which the queue depths are read.
+
+ Latencies go into histograms of power of two microsecond buckets, so percentiles are the upper
+ edge of their bucket, within a factor of two. A reporter thread draws a progress line on stderr
+ about once a second (a line every RUN_METRICS_LOG_SECONDS when stderr isn't a terminal) and writes a
+ snapshot every RUN_METRICS_SNAPSHOT_SECONDS, as Prometheus text when the file name ends in .prom and
+ as JSON otherwise. Snapshots are written next to the file and renamed over it, so a collector never
+ reads half of one.
+ */
+
+#define RUN_METRICS_BUCKETS 24              //1 us to 16 s
+#define RUN_METRICS_LOG_SECONDS 10
+#define RUN_METRICS_SNAPSHOT_SECONDS 10
+
+typedef enum {
+    HDRRunStageOpen = 0,
+    HDRRunStageDecode,
+    HDRRunStageCompute,
+    HDRRunStageWrite,
+    HDRRunStageCount
+} HDRRunStage;
+
+typedef struct {
+    long long count;
+    uint64_t totalNanoseconds;
+    uint64_t maxNanoseconds;
+    long long buckets[RUN_METRICS_BUCKETS];     //Bucket i counts latencies under 2^(i+1) us
+} HDRStageLatency;
+
+typedef struct {
+    double elapsedSeconds;
+    long long framesWritten;
+    long long framesMeasured;       //Read and reduced in this run, not taken from the journal or cache
+    long long framesStored;         //Taken from the journal or cache
+    long long framesFailed;
+    long long framesExpected;       //0 when not known up front, as when frames are streamed or watched
+    uint64_t bytesRead;             //File sizes of the measured frames
+    long long framesPulled;
+    long long framesLoaded;         //Decoded by the I/O threads of the pipelined mode
+    long long framesComputed;
+    HDRStageLatency stages[HDRRunStageCount];
+} HDRRunMetricsSnapshot;
+
+const char * runStageName(HDRRunStage stage);
+
+//Upper edge in milliseconds of the bucket holding the given fraction of latencies, at most the slowest; 0 when empty
+double stageLatencyPercentile(const HDRStageLatency * latency, double percentile);
+
+bool writeRunMetricsJSON(FILE * file, const HDRRunMetricsSnapshot * snapshot);
+bool writeRunMetricsPrometheus(FILE * file, const HDRRunMetricsSnapshot * snapshot);
+
+class HDRRunMetrics {
+public:
+    HDRRunMetrics();
+    ~HDRRunMetrics();
+
+    void setExpectedFrames(long long frames);
+
+    //Called by the workers, in any thread
+    void framePulled() { pulled++; }
+    void frameLoaded() { loaded++; }
+    void frameComputed() { computed++; }
+
+    //Called by the thread writing results, once per frame in result order
+    void addFrame(const HDRFrameTimings & timings, uint64_t writeNanoseconds, uint64_t bytes, bool stored, bool failed);
+
+    HDRRunMetricsSnapshot snapshot();
+
+    //Starts the reporter thread; snapshotPath may be NULL. Returns false if it is already running.
+    bool startReporting(bool progress, const char * snapshotPath);
+
+    //Stops the reporter, clears the progress line and writes a last snapshot. Returns false if that write failed.
+    bool stopReporting();
+
+private:
+    HDRRunMetrics(const HDRRunMetrics &);
+    HDRRunMetrics & operator=(const HDRRunMetrics &);
+
+    void report();
+    bool writeSnapshot();
+
+    std::chrono::steady_clock::time_point start;
+    std::atomic<long long> pulled;
+    std::atomic<long long> loaded;
+    std::atomic<long long> computed;
+
+    std::mutex mutex;                   //Guards totals
+    HDRRunMetricsSnapshot totals;
+
+    std::thread reporter;
+    std::mutex reporterMutex;
+    std::condition_variable reporterWake;
+    bool reporting;
+    bool progress;
+    std::string snapshotPath;
+};
+
+#endif
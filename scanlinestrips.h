@@ -0,0 +1,141 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef SCANLINESTRIPS
+#define SCANLINESTRIPS
+
+#include <OpenImageIO/imageio.h>
+
+#include "bufferarena.h"
+#include "pixelrows.h"
+#include "scenelinear.h"
+#include "stagetiming.h"
+
+/*
+ Streams a band of rows out of an open image a strip at a time instead of decoding the whole frame.
+ Only the RGB channels of rows [yBegin, yEnd) are ever requested from OpenImageIO, so letterbox rows
+ outside the band are never decoded. Each strip is handed on row by row as soon as it is read, and the
+ strip, taken from the caller's arena, is the only pixel memory held.
+
+ With sceneLinear the samples are read as half floats rather than 16-bit codes, and cleaned with
+ clampSceneLinearSamples before any row is handed on.
+ */
+
+#define SCANLINE_STRIP_CHANNELS 3
+#define SCANLINE_STRIP_TARGET_BYTES (2 * 1024 * 1024)
+
+inline void closeImageInput(OIIO::ImageInput * in){
+#ifdef __APPLE__
+    OIIO::ImageInput::destroy (in);
+#else
+    delete in;
+#endif
+}
+
+//Rows per read: a multiple of the file's own strip height close to SCANLINE_STRIP_TARGET_BYTES
+inline int scanlineStripHeight(const OIIO::ImageSpec & spec){
+
+    int rowsPerStrip = spec.get_int_attribute("tiff:RowsPerStrip", 1);
+    if (rowsPerStrip <= 0 || rowsPerStrip > spec.height) {
+        rowsPerStrip = 1;
+    }
+
+    size_t rowBytes = (size_t)spec.width * SCANLINE_STRIP_CHANNELS * sizeof(uint16_t);
+    int targetRows = (int)(SCANLINE_STRIP_TARGET_BYTES / (rowBytes > 0 ? rowBytes : 1));
+    int strips = targetRows / rowsPerStrip;
+
+    return (strips > 0 ? strips : 1) * rowsPerStrip;
+}
+
+//Reads rows [stripBegin, stripEnd) into stripBuffer, timed as reading
+inline bool readScanlineStrip(OIIO::ImageInput * in, int stripBegin, int stripEnd, bool sceneLinear, uint16_t * stripBuffer){
+
+    uint64_t readStart = monotonicNanoseconds();
+    bool read = in->read_scanlines(stripBegin, stripEnd, 0, 0, SCANLINE_STRIP_CHANNELS, sceneLinear ? OIIO::TypeDesc::HALF : OIIO::TypeDesc::UINT16, stripBuffer);
+    threadReadNanoseconds() += monotonicNanoseconds() - readStart;
+
+    if (read && sceneLinear) {
+        clampSceneLinearSamples(stripBuffer, (size_t)in->spec().width * (stripEnd - stripBegin) * SCANLINE_STRIP_CHANNELS);
+    }
+
+    return read;
+}
+
+//Calls function(row, y) for every row of [yBegin, yEnd), y counting from yBegin. Returns false if a read fails.
+template <typename RowFunction>
+bool forEachScanlineInStrips(OIIO::ImageInput * in, int yBegin, int yEnd, HDRBufferArena & arena, RowFunction function, bool sceneLinear = false){
+
+    const OIIO::ImageSpec & spec = in->spec();
+    int stripHeight = scanlineStripHeight(spec);
+    uint16_t * stripBuffer = arena.reservePixels((size_t)spec.width * stripHeight * SCANLINE_STRIP_CHANNELS);
+    if (!stripBuffer) {
+        return false;
+    }
+
+    for (int stripBegin = yBegin; stripBegin < yEnd; stripBegin += stripHeight) {
+
+        int stripEnd = stripBegin + stripHeight < yEnd ? stripBegin + stripHeight : yEnd;
+
+        if (!readScanlineStrip(in, stripBegin, stripEnd, sceneLinear, stripBuffer)) {
+            return false;
+        }
+
+        HDRPixelRegion strip = pixelRegionForFrame(stripBuffer, spec.width, SCANLINE_STRIP_CHANNELS, 0, 0, spec.width, stripEnd - stripBegin);
+        forEachPixelRow(strip, [&](const uint16_t * row, int y){
+            function(row, stripBegin - yBegin + y);
+        });
+    }
+
+    return true;
+}
+
+/*
+ Reads [yBegin, yEnd) a strip at a time from the top, or from the bottom, and stops at the first row in
+ that order for which predicate(row) is true, so rows past it are never decoded. Strips stay on
+ multiples of the strip height counted from row 0, in line with the file's own strips either way.
+ Sets foundY to the row, or -1 if no row matches. Returns false if a read fails.
+ */
+
+template <typename RowPredicate>
+bool findScanlineInStrips(OIIO::ImageInput * in, int yBegin, int yEnd, bool fromBottom, HDRBufferArena & arena, RowPredicate predicate, int & foundY, bool sceneLinear = false){
+
+    const OIIO::ImageSpec & spec = in->spec();
+    int stripHeight = scanlineStripHeight(spec);
+    uint16_t * stripBuffer = arena.reservePixels((size_t)spec.width * stripHeight * SCANLINE_STRIP_CHANNELS);
+    if (!stripBuffer) {
+        return false;
+    }
+
+    foundY = -1;
+
+    int firstStrip = yBegin / stripHeight;
+    int lastStrip = (yEnd - 1) / stripHeight;
+
+    for (int i = 0; i <= lastStrip - firstStrip && yBegin < yEnd; i++) {
+
+        int strip = fromBottom ? lastStrip - i : firstStrip + i;
+        int stripBegin = strip * stripHeight > yBegin ? strip * stripHeight : yBegin;
+        int stripEnd = (strip + 1) * stripHeight < yEnd ? (strip + 1) * stripHeight : yEnd;
+
+        if (!readScanlineStrip(in, stripBegin, stripEnd, sceneLinear, stripBuffer)) {
+            return false;
+        }
+
+        HDRPixelRegion region = pixelRegionForFrame(stripBuffer, spec.width, SCANLINE_STRIP_CHANNELS, 0, 0, spec.width, stripEnd - stripBegin);
+
+        for (int y = 0; y < region.height; y++) {
+            int regionY = fromBottom ? region.height - 1 - y : y;
+            if (predicate(pixelRegionRow(region, regionY))) {
+                foundY = stripBegin + regionY;
+                return true;
+            }
+        }
+    }
+
+    return true;
+}
+
+#endif
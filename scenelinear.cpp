@@ -0,0 +1,49 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "scenelinear.h"
+
+void buildSceneLinearLookupTable(double nitsPerUnit, float * lookupTable){
+    
+    for (int i = 0; i < PQ_LOOKUP_TABLE_SIZE; i++) {
+        //Codes past infinity are negative or NaN and never reach a kernel, as the brightest they keep the table rising for the percentiles
+        double light = i <= SCENE_LINEAR_HALF_INFINITY ? halfToFloat((uint16_t)i) * (nitsPerUnit / 10000.0) : 1.0;
+        lookupTable[i] = (float)(light < 1.0 ? light : 1.0);
+    }
+}
+
+const float * sharedSceneLinearLookupTable(double nitsPerUnit){
+    
+    static std::mutex lookupTablesMutex;
+    static std::map<double, std::vector<float> *> lookupTables;
+    
+    std::lock_guard<std::mutex> lock(lookupTablesMutex);
+    
+    std::map<double, std::vector<float> *>::iterator found = lookupTables.find(nitsPerUnit);
+    if (found != lookupTables.end()) {
+        return found->second->data();
+    }
+    
+    std::vector<float> * lookupTable = new std::vector<float>(PQ_LOOKUP_TABLE_SIZE);
+    buildSceneLinearLookupTable(nitsPerUnit, lookupTable->data());
+    lookupTables[nitsPerUnit] = lookupTable;
+    
+    return lookupTable->data();
+}
+
+HDRLightLevelKernel selectSceneLinearLightLevelKernel(HDRColorSpace colorSpace, double nitsPerUnit, bool luminanceHistogram){
+    
+    HDRLightLevelKernel kernel;
+    kernel.reduceRow = lightLevelRowFunctionForISA(selectedLightLevelKernelISA(), colorSpace, luminanceHistogram);
+    kernel.reduceByteSwappedRow = lightLevelRowFunctionForISA(selectedLightLevelKernelISA(), colorSpace, luminanceHistogram, true);
+    kernel.lookupTable = sharedSceneLinearLookupTable(nitsPerUnit);
+    kernel.sceneLinear = true;
+    return kernel;
+}
@@ -0,0 +1,75 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef SCENELINEAR
+#define SCENELINEAR
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "luminancekernel.h"
+
+/*
+ Scene-linear frames, such as OpenEXR masters, are measured from their half float samples instead of
+ being quantized to 16-bit PQ codes first. A half has only 65536 bit patterns, so the conversion to
+ nits is one more lookup table for the kernels: entry h holds the half h times the nits of a linear
+ 1.0, normalized to 10000 cd/m2 like the PQ tables. The kernels, their results on every ISA and the
+ histograms stay as they are, with no PQ curve involved. Float samples are rounded to half by
+ OpenImageIO as they are read, a relative error below 0.05%.
+
+ Positive halves sort like their bit patterns, so once negative and NaN samples are cleared to 0 by
+ clampSceneLinearSamples the largest code of a pixel is still its brightest component. Light above
+ 10000 cd/m2, or infinite, is clamped to 10000. The maxCLL histogram then has 16 bins per octave.
+ */
+
+#define SCENE_LINEAR_HALF_INFINITY 0x7C00
+
+inline float halfToFloat(uint16_t half){
+    
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+    
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        //Subnormal, normalized for the wider exponent
+        exponent = 113;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//Clears negative and NaN half samples to 0 in place, every bit pattern above positive infinity is one of those
+inline void clampSceneLinearSamples(uint16_t * samples, size_t count){
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = samples[i] > SCENE_LINEAR_HALF_INFINITY ? 0 : samples[i];
+    }
+}
+
+//Fills PQ_LOOKUP_TABLE_SIZE entries mapping half samples to normalized linear light, nitsPerUnit being the cd/m2 of 1.0
+void buildSceneLinearLookupTable(double nitsPerUnit, float * lookupTable);
+
+//Returns the table for nitsPerUnit, built once on first use and shared like sharedPQLookupTable
+const float * sharedSceneLinearLookupTable(double nitsPerUnit);
+
+//Picks the row function for a job on scene-linear half rows, nitsPerUnit must be positive
+HDRLightLevelKernel selectSceneLinearLightLevelKernel(HDRColorSpace colorSpace, double nitsPerUnit, bool luminanceHistogram);
+
+#endif
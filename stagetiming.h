@@ -0,0 +1,39 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef STAGETIMING
+#define STAGETIMING
+
+#include <stdint.h>
+
+#include <chrono>
+
+/*
+ Where the time of one frame went. Opening covers finding the file and parsing its header, decoding
+ covers every read_scanlines call and computing is the rest of the frame, mostly the light level
+ kernel. In the strip reader decoding and computing alternate strip by strip, so reads are timed as
+ they happen into a per thread total and a frame takes the difference across it. That costs two clock
+ reads per strip, not per row.
+ */
+
+typedef struct {
+    uint64_t openNanoseconds;
+    uint64_t decodeNanoseconds;
+    uint64_t computeNanoseconds;
+    bool measured;              //False for results taken from the journal or cache, or that failed to open
+} HDRFrameTimings;
+
+inline uint64_t monotonicNanoseconds(){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Total time the calling thread has spent in image reads
+inline uint64_t & threadReadNanoseconds(){
+    static thread_local uint64_t nanoseconds = 0;
+    return nanoseconds;
+}
+
+#endif
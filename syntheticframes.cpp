@@ -0,0 +1,130 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <math.h>
+
+#include <vector>
+
+#include <OpenImageIO/imageio.h>
+
+#include "syntheticframes.h"
+
+OIIO_NAMESPACE_USING
+
+#define SYNTHETIC_LETTERBOX_ASPECT 2.39
+#define SYNTHETIC_SPECULAR_SIZE 4
+#define SYNTHETIC_SPECULAR_CODE 60000
+
+const char * syntheticFrameKindName(HDRSyntheticFrameKind kind){
+    
+    switch (kind) {
+        case HDRSyntheticLetterbox: return "letterbox";
+        case HDRSyntheticFullFrame: return "full";
+        case HDRSyntheticSpecular: return "specular";
+        case HDRSyntheticBlack: return "black";
+        default: return "unknown";
+    }
+}
+
+std::pair<int, int> syntheticFrameActiveRows(HDRSyntheticFrameKind kind, int width, int height){
+    
+    if (kind == HDRSyntheticBlack) {
+        return std::make_pair(-1, -1);
+    }
+    
+    if (kind == HDRSyntheticLetterbox) {
+        int pictureHeight = (int)lround(width / SYNTHETIC_LETTERBOX_ASPECT);
+        if (pictureHeight < height) {
+            return std::make_pair((height - pictureHeight) / 2, pictureHeight);
+        }
+    }
+    
+    return std::make_pair(0, height);
+}
+
+static inline uint32_t nextRandom(uint32_t & state){
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void fillSyntheticFrame(HDRSyntheticFrameKind kind, int width, int height, uint32_t seed, uint16_t * pixels){
+    
+    std::pair<int, int> rows = syntheticFrameActiveRows(kind, width, height);
+    
+    //Dim enough in a specular frame for the highlights to stand out
+    int base = kind == HDRSyntheticSpecular ? 8000 : 12000;
+    int span = kind == HDRSyntheticSpecular ? 12000 : 28000;
+    
+    for (int y = 0; y < height; y++) {
+        
+        uint16_t * row = pixels + ((size_t)y * width * 3);
+        
+        if (y < rows.first || y >= rows.first + rows.second) {
+            for (int i = 0; i < width * 3; i++) {
+                row[i] = 0;
+            }
+            continue;
+        }
+        
+        //Every row has its own stream, so rows don't depend on the order they are filled in
+        uint32_t state = (seed * 2654435761u) ^ ((uint32_t)y * 40503u) ^ 0x9E3779B9u;
+        nextRandom(state);
+        
+        for (int x = 0; x < width; x++) {
+            int gradient = base + (int)(((int64_t)span * (x + y)) / (width + height));
+            row[(x * 3) + 0] = (uint16_t)(gradient + (nextRandom(state) & 1023));
+            row[(x * 3) + 1] = (uint16_t)(gradient + (nextRandom(state) & 1023));
+            row[(x * 3) + 2] = (uint16_t)(gradient + (nextRandom(state) & 1023));
+        }
+    }
+    
+    if (kind != HDRSyntheticSpecular) {
+        return;
+    }
+    
+    //Square highlights covering about 0.1% of the frame
+    uint32_t state = seed ^ 0x85EBCA6Bu;
+    nextRandom(state);
+    long long highlights = ((long long)width * height) / (1000 * SYNTHETIC_SPECULAR_SIZE * SYNTHETIC_SPECULAR_SIZE);
+    
+    for (long long i = 0; i < highlights; i++) {
+        int x0 = (int)(nextRandom(state) % (uint32_t)(width - SYNTHETIC_SPECULAR_SIZE));
+        int y0 = (int)(nextRandom(state) % (uint32_t)(height - SYNTHETIC_SPECULAR_SIZE));
+        for (int y = y0; y < y0 + SYNTHETIC_SPECULAR_SIZE; y++) {
+            uint16_t * pixel = pixels + (((size_t)y * width + x0) * 3);
+            for (int x = 0; x < SYNTHETIC_SPECULAR_SIZE * 3; x++) {
+                pixel[x] = (uint16_t)(SYNTHETIC_SPECULAR_CODE + (x % 3) * 1000);
+            }
+        }
+    }
+}
+
+bool writeSyntheticFrame(const char * path, HDRSyntheticFrameKind kind, int width, int height, uint32_t seed){
+    
+    std::vector<uint16_t> pixels((size_t)width * height * 3);
+    fillSyntheticFrame(kind, width, height, seed, pixels.data());
+    
+    ImageOutput * out = ImageOutput::create(path);
+    if (!out) {
+        return false;
+    }
+    
+    ImageSpec spec(width, height, 3, TypeDesc::UINT16);
+    spec.attribute("compression", "none");
+    
+    bool written = out->open(path, spec) && out->write_image(TypeDesc::UINT16, pixels.data());
+    written = out->close() && written;
+    
+#ifdef __APPLE__
+    ImageOutput::destroy(out);
+#else
+    delete out;
+#endif
+    
+    return written;
+}
@@ -0,0 +1,44 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef SYNTHETICFRAMES
+#define SYNTHETICFRAMES
+
+#include <stdint.h>
+
+#include <utility>
+
+/*
+ Deterministic 16-bit RGB test frames for the benchmarks. The same kind, size and seed always give the
+ same pixels. Picture rows carry noise in every channel so no picture row is ever flat; letterbox bars
+ and black frames are code 0.
+
+   letterbox   a 2.39:1 picture centred between black bars
+   full        picture over the whole frame
+   specular    a dim picture with small highlights near the top of the PQ range, about 0.1% of pixels
+   black       every pixel code 0
+ */
+
+typedef enum {
+    HDRSyntheticLetterbox = 0,
+    HDRSyntheticFullFrame,
+    HDRSyntheticSpecular,
+    HDRSyntheticBlack,
+    HDRSyntheticFrameKindCount
+} HDRSyntheticFrameKind;
+
+const char * syntheticFrameKindName(HDRSyntheticFrameKind kind);
+
+//The active rows (y, height) getActiveAreaDimensionsForFilePath should find, (-1, -1) for a black frame
+std::pair<int, int> syntheticFrameActiveRows(HDRSyntheticFrameKind kind, int width, int height);
+
+//Fills width * height interleaved RGB pixels
+void fillSyntheticFrame(HDRSyntheticFrameKind kind, int width, int height, uint32_t seed, uint16_t * pixels);
+
+//Writes the frame as an uncompressed 16-bit RGB TIFF. Returns false if it can't be written.
+bool writeSyntheticFrame(const char * path, HDRSyntheticFrameKind kind, int width, int height, uint32_t seed);
+
+#endif
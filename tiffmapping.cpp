@@ -0,0 +1,266 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <atomic>
+
+#include "tiffmapping.h"
+
+#define TIFF_TAG_IMAGE_WIDTH 256
+#define TIFF_TAG_IMAGE_LENGTH 257
+#define TIFF_TAG_BITS_PER_SAMPLE 258
+#define TIFF_TAG_COMPRESSION 259
+#define TIFF_TAG_PHOTOMETRIC 262
+#define TIFF_TAG_STRIP_OFFSETS 273
+#define TIFF_TAG_SAMPLES_PER_PIXEL 277
+#define TIFF_TAG_ROWS_PER_STRIP 278
+#define TIFF_TAG_STRIP_BYTE_COUNTS 279
+#define TIFF_TAG_PLANAR_CONFIGURATION 284
+#define TIFF_TAG_TILE_WIDTH 322
+#define TIFF_TAG_SAMPLE_FORMAT 339
+
+#define TIFF_TYPE_SHORT 3
+#define TIFF_TYPE_LONG 4
+
+static std::atomic<bool> mappedReadsEnabled(true);
+
+void setMappedTiffReadsEnabled(bool enabled){
+    mappedReadsEnabled = enabled;
+}
+
+bool mappedTiffReadsEnabled(){
+    return mappedReadsEnabled;
+}
+
+//Bounds checked reads of the file's own byte order
+typedef struct {
+    const unsigned char * bytes;
+    size_t size;
+    bool bigEndian;
+} HDRTiffBytes;
+
+static bool readTiff16(const HDRTiffBytes & file, uint64_t offset, uint32_t & value){
+    if (offset + 2 > file.size) {
+        return false;
+    }
+    const unsigned char * b = file.bytes + offset;
+    value = file.bigEndian ? ((uint32_t)b[0] << 8) | b[1] : ((uint32_t)b[1] << 8) | b[0];
+    return true;
+}
+
+static bool readTiff32(const HDRTiffBytes & file, uint64_t offset, uint32_t & value){
+    if (offset + 4 > file.size) {
+        return false;
+    }
+    const unsigned char * b = file.bytes + offset;
+    value = file.bigEndian ? ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3]
+                           : ((uint32_t)b[3] << 24) | ((uint32_t)b[2] << 16) | ((uint32_t)b[1] << 8) | b[0];
+    return true;
+}
+
+typedef struct {
+    uint32_t type;
+    uint32_t count;
+    uint64_t valueOffset;       //Of the values, inside the entry when they fit in 4 bytes
+} HDRTiffEntry;
+
+//Value i of a SHORT or LONG entry
+static bool readTiffValue(const HDRTiffBytes & file, const HDRTiffEntry & entry, uint32_t i, uint32_t & value){
+    if (i >= entry.count) {
+        return false;
+    }
+    if (entry.type == TIFF_TYPE_SHORT) {
+        return readTiff16(file, entry.valueOffset + ((uint64_t)i * 2), value);
+    }
+    if (entry.type == TIFF_TYPE_LONG) {
+        return readTiff32(file, entry.valueOffset + ((uint64_t)i * 4), value);
+    }
+    return false;
+}
+
+//Checks the first directory and fills in the layout. False for anything that can't be read in place.
+static bool readTiffLayout(const HDRTiffBytes & file, HDRMappedTiff * tiff){
+    
+    uint32_t magic, directory, entryCount;
+    if (!readTiff16(file, 2, magic) || magic != 42 || !readTiff32(file, 4, directory) || !readTiff16(file, directory, entryCount)) {
+        return false;
+    }
+    
+    HDRTiffEntry stripOffsets = {0, 0, 0};
+    HDRTiffEntry stripByteCounts = {0, 0, 0};
+    HDRTiffEntry bitsPerSample = {0, 0, 0};
+    uint32_t width = 0, height = 0, samplesPerPixel = 1, rowsPerStrip = 0xFFFFFFFF;
+    uint32_t compression = 1, photometric = 0, planarConfiguration = 1, sampleFormat = 1;
+    
+    for (uint32_t i = 0; i < entryCount; i++) {
+        
+        uint64_t offset = (uint64_t)directory + 2 + ((uint64_t)i * 12);
+        uint32_t tag, type, count, inlineOrOffset;
+        if (!readTiff16(file, offset, tag) || !readTiff16(file, offset + 2, type) || !readTiff32(file, offset + 4, count) || !readTiff32(file, offset + 8, inlineOrOffset)) {
+            return false;
+        }
+        
+        uint32_t valueSize = type == TIFF_TYPE_SHORT ? 2 : (type == TIFF_TYPE_LONG ? 4 : 0);
+        HDRTiffEntry entry = {type, count, (uint64_t)count * valueSize <= 4 ? offset + 8 : inlineOrOffset};
+        uint32_t value = 0;
+        bool hasValue = valueSize != 0 && readTiffValue(file, entry, 0, value);
+        
+        switch (tag) {
+            case TIFF_TAG_IMAGE_WIDTH: if (!hasValue) { return false; } width = value; break;
+            case TIFF_TAG_IMAGE_LENGTH: if (!hasValue) { return false; } height = value; break;
+            case TIFF_TAG_BITS_PER_SAMPLE: bitsPerSample = entry; break;
+            case TIFF_TAG_COMPRESSION: if (!hasValue) { return false; } compression = value; break;
+            case TIFF_TAG_PHOTOMETRIC: if (!hasValue) { return false; } photometric = value; break;
+            case TIFF_TAG_STRIP_OFFSETS: stripOffsets = entry; break;
+            case TIFF_TAG_SAMPLES_PER_PIXEL: if (!hasValue) { return false; } samplesPerPixel = value; break;
+            case TIFF_TAG_ROWS_PER_STRIP: if (!hasValue) { return false; } rowsPerStrip = value; break;
+            case TIFF_TAG_STRIP_BYTE_COUNTS: stripByteCounts = entry; break;
+            case TIFF_TAG_PLANAR_CONFIGURATION: if (!hasValue) { return false; } planarConfiguration = value; break;
+            case TIFF_TAG_TILE_WIDTH: return false;
+            case TIFF_TAG_SAMPLE_FORMAT: if (!hasValue) { return false; } sampleFormat = value; break;
+            default: break;
+        }
+    }
+    
+    if (width == 0 || height == 0 || width > 0x7FFFFFF || height > 0x7FFFFFF || compression != 1 || photometric != 2 ||
+        samplesPerPixel != 3 || planarConfiguration != 1 || sampleFormat != 1 || bitsPerSample.count != 3) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < 3; i++) {
+        uint32_t bits;
+        if (!readTiffValue(file, bitsPerSample, i, bits) || bits != 16) {
+            return false;
+        }
+    }
+    
+    if (rowsPerStrip == 0 || rowsPerStrip > height) {
+        rowsPerStrip = height;
+    }
+    
+    uint32_t stripCount = (height + rowsPerStrip - 1) / rowsPerStrip;
+    if (stripOffsets.count != stripCount || stripByteCounts.count != stripCount) {
+        return false;
+    }
+    
+    tiff->width = (int)width;
+    tiff->height = (int)height;
+    tiff->rowsPerStrip = (int)rowsPerStrip;
+    tiff->stripOffsets.resize(stripCount);
+    
+    uint64_t rowBytes = (uint64_t)width * 3 * sizeof(uint16_t);
+    
+    for (uint32_t i = 0; i < stripCount; i++) {
+        
+        uint32_t offset, byteCount;
+        if (!readTiffValue(file, stripOffsets, i, offset) || !readTiffValue(file, stripByteCounts, i, byteCount)) {
+            return false;
+        }
+        
+        //The last strip only holds the rows left over
+        uint64_t rows = i + 1 < stripCount ? rowsPerStrip : height - ((uint64_t)i * rowsPerStrip);
+        if ((offset & 1) != 0 || byteCount < rows * rowBytes || (uint64_t)offset + (rows * rowBytes) > file.size) {
+            return false;
+        }
+        
+        tiff->stripOffsets[i] = offset;
+    }
+    
+    return true;
+}
+
+bool mapUncompressedTiff(const char * path, HDRMappedTiff * tiff){
+    
+    tiff->mapping = NULL;
+    tiff->mappingSize = 0;
+    
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size < 8) {
+        close(file);
+        return false;
+    }
+    
+    size_t size = (size_t)status.st_size;
+    void * mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    
+    const unsigned char * bytes = (const unsigned char *)mapping;
+    uint16_t host = 1;
+    bool hostLittleEndian = *(const unsigned char *)&host == 1;
+    
+    HDRTiffBytes tiffBytes = {bytes, size, bytes[0] == 'M'};
+    bool isTiff = (bytes[0] == 'I' && bytes[1] == 'I') || (bytes[0] == 'M' && bytes[1] == 'M');
+    
+    if (!isTiff || !readTiffLayout(tiffBytes, tiff)) {
+        munmap(mapping, size);
+        tiff->stripOffsets.clear();
+        return false;
+    }
+    
+    tiff->mapping = mapping;
+    tiff->mappingSize = size;
+    tiff->byteSwapped = tiffBytes.bigEndian == hostLittleEndian;
+    
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    
+    return true;
+}
+
+void unmapUncompressedTiff(HDRMappedTiff * tiff){
+    
+    if (tiff->mapping) {
+        munmap(tiff->mapping, tiff->mappingSize);
+    }
+    
+    tiff->mapping = NULL;
+    tiff->mappingSize = 0;
+    tiff->stripOffsets.clear();
+}
+
+void adviseMappedTiffRows(const HDRMappedTiff * tiff, int yBegin, int yEnd){
+    
+    if (yBegin >= yEnd) {
+        return;
+    }
+    
+    //Strips are usually back to back in row order but needn't be, so contiguous runs of them are advised together
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t rowBytes = (size_t)tiff->width * 3 * sizeof(uint16_t);
+    size_t runBegin = 0, runEnd = 0;
+    
+    for (int y = yBegin; y < yEnd; ) {
+        
+        int stripEnd = ((y / tiff->rowsPerStrip) + 1) * tiff->rowsPerStrip;
+        int rows = (stripEnd < yEnd ? stripEnd : yEnd) - y;
+        size_t begin = (size_t)((const char *)mappedTiffRow(tiff, y) - (const char *)tiff->mapping);
+        
+        if (begin != runEnd || runEnd == 0) {
+            if (runEnd > runBegin) {
+                madvise((char *)tiff->mapping + runBegin, runEnd - runBegin, MADV_WILLNEED);
+            }
+            runBegin = begin - (begin % pageSize);
+        }
+        runEnd = begin + ((size_t)rows * rowBytes);
+        
+        y += rows;
+    }
+    
+    madvise((char *)tiff->mapping + runBegin, runEnd - runBegin, MADV_WILLNEED);
+}
@@ -0,0 +1,56 @@
+//  Copyright (c) 2016 Patrick Cusack. All rights reserved.
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef TIFFMAPPING
+#define TIFFMAPPING
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/*
+ Reads uncompressed 16-bit RGB TIFFs, most of what is delivered, without OpenImageIO: the file is
+ mapped into memory and the kernel runs on the rows where they lie in the mapping, so no frame is
+ copied or converted and no pixel memory is allocated. Files in the other byte order are reduced with
+ the byte swapping kernels.
+
+ Only the first image of a classic (not Big) TIFF is mapped, and only when it is uncompressed, chunky
+ (PlanarConfiguration 1), in strips, with exactly three unsigned 16-bit samples per pixel and every
+ strip at an even offset inside the file. Anything else is left to OpenImageIO.
+
+ A mapped file that is truncated while it is being read raises SIGBUS, so mapping can be turned off
+ for folders whose frames may be rewritten in place.
+ */
+
+typedef struct {
+    void * mapping;
+    size_t mappingSize;
+    int width;
+    int height;
+    int rowsPerStrip;
+    bool byteSwapped;                   //Samples are in the other byte order than the host's
+    std::vector<uint64_t> stripOffsets;
+} HDRMappedTiff;
+
+//Maps path if it can be read in place as described above. Returns false, leaving nothing mapped, otherwise.
+bool mapUncompressedTiff(const char * path, HDRMappedTiff * tiff);
+
+void unmapUncompressedTiff(HDRMappedTiff * tiff);
+
+inline const uint16_t * mappedTiffRow(const HDRMappedTiff * tiff, int y){
+    size_t rowBytes = (size_t)tiff->width * 3 * sizeof(uint16_t);
+    return (const uint16_t *)((const char *)tiff->mapping + tiff->stripOffsets[y / tiff->rowsPerStrip] + ((size_t)(y % tiff->rowsPerStrip) * rowBytes));
+}
+
+//Starts reading rows [yBegin, yEnd) ahead of the kernel
+void adviseMappedTiffRows(const HDRMappedTiff * tiff, int yBegin, int yEnd);
+
+//On by default
+void setMappedTiffReadsEnabled(bool enabled);
+bool mappedTiffReadsEnabled();
+
+#endif